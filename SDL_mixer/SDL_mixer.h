@@ -124,6 +124,12 @@ extern int Mix_GetNumChunkDecoders(void);
 extern const char * Mix_GetChunkDecoder(int index);
 extern int Mix_GetNumMusicDecoders(void);
 
+/* Set a function that is called after all mixing is performed.
+   This can be used to provide real-time visual display of the audio stream
+   or add a custom mixer filter for the stream data.
+*/
+extern void Mix_SetPostMix(void (*mix_func)(void *udata, uint8_t *stream, int len), void *arg);
+
 /* Add your own music player or additional mixer function.
    If 'mix_func' is NULL, the default music player is re-enabled.
  */
@@ -298,6 +304,12 @@ extern int Mix_GroupOldest(int tag);
 /* The same as above, but the sound is played at most 'ticks' milliseconds */
 extern int Mix_PlayChannelTimed(int channel, Mix_Chunk *chunk, int loops, int ticks);
 
+/* Start the sound just played on a channel 'frames' sample frames into the
+   next mix instead of at its beginning.
+   Returns the channel, or -1 on error.
+*/
+extern int Mix_DelayChannel(int channel, int frames);
+
 /* Set the volume in the range of 0-128 of a specific channel or chunk.
    If the specified channel is -1, set volume for all channels.
    Returns the original volume.
@@ -345,6 +357,12 @@ extern int Mix_Playing(int channel);
 */
 extern Mix_Chunk * Mix_GetChunk(int channel);
 
+/* Keep the mixing callback, and the hooks it calls, out while a group of
+   calls or the data those hooks read is changed. Calls nest.
+*/
+extern void Mix_LockAudio(void);
+extern void Mix_UnlockAudio(void);
+
 /* Close the mixer, halting all playing audio */
 extern void Mix_CloseAudio(void);
 
@@ -54,6 +54,7 @@ static struct _Mix_Channel
     int tag;
     uint32_t expire;
     uint32_t start_time;
+    int delay;          /* bytes of the next mix before the chunk starts */
     Mix_Fading fading;
     int fade_volume;
     int fade_volume_reset;
@@ -80,6 +81,10 @@ extern void music_mixer(void *udata, uint8_t *stream, int len);
 static void (*mix_music)(void *udata, uint8_t *stream, int len) = music_mixer;
 static void *music_data = NULL;
 
+/* The postmix function, run after everything else is mixed */
+static void (*mix_postmix)(void *udata, uint8_t *stream, int len) = NULL;
+static void *mix_postmix_data = NULL;
+
 /* rcg06042009 report available decoders at runtime. */
 static const char **chunk_decoders = NULL;
 static int num_decoders = 0;
@@ -168,7 +173,7 @@ static void mix_channels(void *udata, uint8_t *stream, int len)
       mix_music(music_data, stream, len);
 
    /* Mix any playing channels... */
-   sdl_ticks = LR_GetTicks();
+   sdl_ticks = LR_GetRealTicks();
    for ( i=0; i<num_channels; ++i )
    {
       if( ! mix_channel[i].paused )
@@ -211,8 +216,16 @@ static void mix_channels(void *udata, uint8_t *stream, int len)
 
          if ( mix_channel[i].playing > 0 )
          {
-            int index = 0;
+            int index = mix_channel[i].delay;
             int remaining = len;
+
+            /* a delayed start leaves the front of the buffer alone */
+            mix_channel[i].delay = 0;
+            if ( index > len )
+            {
+               mix_channel[i].delay = index - len;
+               index = len;
+            }
             while (mix_channel[i].playing > 0 && index < len)
             {
                remaining = len - index;
@@ -268,6 +281,9 @@ static void mix_channels(void *udata, uint8_t *stream, int len)
 
    /* rcg06122001 run posteffects... */
    Mix_DoEffects(MIX_CHANNEL_POST, stream, len);
+
+   if ( mix_postmix )
+      mix_postmix(mix_postmix_data, stream, len);
 }
 
 /* Open the mixer with a certain desired audio format */
@@ -322,6 +338,7 @@ int Mix_OpenAudio(int frequency, uint16_t format, int nchannels, int chunksize)
       mix_channel[i].fading = MIX_NO_FADING;
       mix_channel[i].tag = -1;
       mix_channel[i].expire = 0;
+      mix_channel[i].delay = 0;
       mix_channel[i].effects = NULL;
       mix_channel[i].paused = 0;
    }
@@ -369,6 +386,7 @@ int Mix_AllocateChannels(int numchans)
          mix_channel[i].fading = MIX_NO_FADING;
          mix_channel[i].tag = -1;
          mix_channel[i].expire = 0;
+         mix_channel[i].delay = 0;
          mix_channel[i].effects = NULL;
          mix_channel[i].paused = 0;
       }
@@ -557,6 +575,16 @@ void Mix_FreeChunk(Mix_Chunk *chunk)
    }
 }
 
+/* Add your own callback when the mixer is done, in place on the final stream.
+   If 'mix_func' is NULL, no postmix is run.
+   */
+void Mix_SetPostMix(void (*mix_func)(void *udata, uint8_t *stream, int len),
+      void *arg)
+{
+   mix_postmix_data = arg;
+   mix_postmix = mix_func;
+}
+
 /* Add your own music player or mixer function.
    If 'mix_func' is NULL, the default music player is re-enabled.
    */
@@ -643,7 +671,7 @@ int Mix_PlayChannelTimed(int which, Mix_Chunk *chunk, int loops, int ticks)
    /* Queue up the audio data for this channel */
    if ( which >= 0 && which < num_channels )
    {
-      uint32_t sdl_ticks = LR_GetTicks();
+      uint32_t sdl_ticks = LR_GetRealTicks();
       if (Mix_Playing(which))
          _Mix_channel_done_playing(which);
       mix_channel[which].samples = chunk->abuf;
@@ -654,12 +682,29 @@ int Mix_PlayChannelTimed(int which, Mix_Chunk *chunk, int loops, int ticks)
       mix_channel[which].fading = MIX_NO_FADING;
       mix_channel[which].start_time = sdl_ticks;
       mix_channel[which].expire = (ticks > 0) ? (sdl_ticks + ticks) : 0;
+      mix_channel[which].delay = 0;
    }
 
    /* Return the channel on which the sound is being played */
    return(which);
 }
 
+/* Delay the start of a sound just played on a channel by 'frames'
+   sample frames into the next mix, for sample accurate triggers */
+int Mix_DelayChannel(int which, int frames)
+{
+   int frame_width = 1;
+
+   if ( which < 0 || which >= num_channels || frames < 0 )
+      return(-1);
+
+   if ((mixer.format & 0xFF) == 16)
+      frame_width = 2;
+   frame_width *= mixer.channels;
+   mix_channel[which].delay = frames * frame_width;
+   return(which);
+}
+
 /* Change the expiration delay for a channel */
 int Mix_ExpireChannel(int which, int ticks)
 {
@@ -673,7 +718,7 @@ int Mix_ExpireChannel(int which, int ticks)
    }
    else if ( which < num_channels )
    {
-      mix_channel[which].expire = (ticks>0) ? (LR_GetTicks() + ticks) : 0;
+      mix_channel[which].expire = (ticks>0) ? (LR_GetRealTicks() + ticks) : 0;
       ++ status;
    }
    return(status);
@@ -723,6 +768,7 @@ int Mix_HaltChannel(int which)
          mix_channel[which].looping = 0;
       }
       mix_channel[which].expire = 0;
+      mix_channel[which].delay = 0;
       if(mix_channel[which].fading != MIX_NO_FADING) /* Restore volume */
          mix_channel[which].volume = mix_channel[which].fade_volume_reset;
       mix_channel[which].fading = MIX_NO_FADING;
@@ -776,6 +822,17 @@ Mix_Chunk *Mix_GetChunk(int channel)
    return(retval);
 }
 
+/* Hold off the mixing callback while the caller changes shared state */
+void Mix_LockAudio(void)
+{
+   SDL_LockAudio();
+}
+
+void Mix_UnlockAudio(void)
+{
+   SDL_UnlockAudio();
+}
+
 /* Close the mixer, halting all playing audio */
 void Mix_CloseAudio(void)
 {
@@ -803,7 +860,7 @@ void Mix_CloseAudio(void)
 /* Pause a particular channel (or all) */
 void Mix_Pause(int which)
 {
-   uint32_t sdl_ticks = LR_GetTicks();
+   uint32_t sdl_ticks = LR_GetRealTicks();
    if ( which == -1 )
    {
       int i;
@@ -824,7 +881,7 @@ void Mix_Pause(int which)
 /* Resume a paused channel */
 void Mix_Resume(int which)
 {
-   uint32_t sdl_ticks = LR_GetTicks();
+   uint32_t sdl_ticks = LR_GetRealTicks();
 
    if (which == -1)
    {
@@ -906,7 +963,7 @@ int Mix_GroupOldest(int tag)
 {
    int i;
    int         chan = -1;
-   uint32_t mintime = LR_GetTicks();
+   uint32_t mintime = LR_GetRealTicks();
 
    for( i=0; i < num_channels; i ++ )
    {
@@ -643,8 +643,8 @@ static INLINE void advance_lfo(FM_OPL *OPL)
    LFO_PM = ((OPL->lfo_pm_cnt>>LFO_SH) & 7) | OPL->lfo_pm_depth_range;
 }
 
-/* advance to next sample */
-static INLINE void advance(FM_OPL *OPL)
+/* advance to next sample, skipping the channels set in 'idle' */
+static INLINE void advance(FM_OPL *OPL, UINT32 idle)
 {
    OPL_CH *CH;
    OPL_SLOT *op;
@@ -660,6 +660,9 @@ static INLINE void advance(FM_OPL *OPL)
 
       for (i=0; i<9*2; i++)
       {
+         if (idle & (1<<(i/2)))
+            continue;
+
          CH  = &OPL->P_CH[i/2];
          op  = &CH->SLOT[i&1];
 
@@ -739,6 +742,9 @@ static INLINE void advance(FM_OPL *OPL)
 
    for (i=0; i<9*2; i++)
    {
+      if (idle & (1<<(i/2)))
+         continue;
+
       CH  = &OPL->P_CH[i/2];
       op  = &CH->SLOT[i&1];
 
@@ -1818,27 +1824,39 @@ void YM3812SetUpdateHandler(int which,OPL_UPDATEHANDLER UpdateHandler,int param)
 
 
 /*
-** Generate samples for one of the YM3812's
-**
-** 'which' is the virtual YM3812 number
-** '*buffer' is the output buffer pointer
-** 'length' is the number of samples that should be generated
+** Channels that stay silent for a whole update: both slots are off, which
+** only a key on can change, and nothing is left in the feedback. An off
+** slot's phase restarts at key on, so it need not be advanced either.
+** In rhythm mode channels 6-8 share their phases and are never idle.
 */
-void YM3812UpdateOne(int which, INT16 *buffer, int length)
+static UINT32 OPLIdleChannels(FM_OPL *OPL)
 {
-    FM_OPL      *OPL = OPL_YM3812[which];
-    UINT8       rhythm = OPL->rhythm&0x20;
-    OPLSAMPLE   *buf = buffer;
-    int i;
+    UINT32 idle = 0;
+    int ch, last = (OPL->rhythm&0x20) ? 6 : 9;
+
+    for( ch=0; ch < last ; ch++ )
+    {
+        OPL_CH *CH = &OPL->P_CH[ch];
 
-    if( (void *)OPL != cur_chip ){
-        cur_chip = (void *)OPL;
-        /* rhythm slots */
-        SLOT7_1 = &OPL->P_CH[7].SLOT[SLOT1];
-        SLOT7_2 = &OPL->P_CH[7].SLOT[SLOT2];
-        SLOT8_1 = &OPL->P_CH[8].SLOT[SLOT1];
-        SLOT8_2 = &OPL->P_CH[8].SLOT[SLOT2];
+        if( CH->SLOT[SLOT1].state == EG_OFF && CH->SLOT[SLOT2].state == EG_OFF
+            && !CH->SLOT[SLOT1].op1_out[0] && !CH->SLOT[SLOT1].op1_out[1] )
+            idle |= 1<<ch;
     }
+    return idle;
+}
+
+static void OPLRender(FM_OPL *OPL, OPLSAMPLE *buf, int length, UINT32 idle)
+{
+    UINT8       rhythm = OPL->rhythm&0x20;
+    int i, ch;
+
+    /* rhythm slots */
+    cur_chip = (void *)OPL;
+    SLOT7_1 = &OPL->P_CH[7].SLOT[SLOT1];
+    SLOT7_2 = &OPL->P_CH[7].SLOT[SLOT2];
+    SLOT8_1 = &OPL->P_CH[8].SLOT[SLOT1];
+    SLOT8_2 = &OPL->P_CH[8].SLOT[SLOT2];
+
     for( i=0; i < length ; i++ )
     {
         int lt;
@@ -1848,18 +1866,15 @@ void YM3812UpdateOne(int which, INT16 *buffer, int length)
         advance_lfo(OPL);
 
         /* FM part */
-        OPL_CALC_CH(&OPL->P_CH[0]);
-        OPL_CALC_CH(&OPL->P_CH[1]);
-        OPL_CALC_CH(&OPL->P_CH[2]);
-        OPL_CALC_CH(&OPL->P_CH[3]);
-        OPL_CALC_CH(&OPL->P_CH[4]);
-        OPL_CALC_CH(&OPL->P_CH[5]);
+        for( ch=0; ch < 6 ; ch++ )
+            if( !(idle & (1<<ch)) )
+                OPL_CALC_CH(&OPL->P_CH[ch]);
 
         if(!rhythm)
         {
-            OPL_CALC_CH(&OPL->P_CH[6]);
-            OPL_CALC_CH(&OPL->P_CH[7]);
-            OPL_CALC_CH(&OPL->P_CH[8]);
+            for( ch=6; ch < 9 ; ch++ )
+                if( !(idle & (1<<ch)) )
+                    OPL_CALC_CH(&OPL->P_CH[ch]);
         }
         else        /* Rhythm part */
         {
@@ -1877,8 +1892,47 @@ void YM3812UpdateOne(int which, INT16 *buffer, int length)
         buf[i*2] = lt;          // stereo version
         buf[i*2+1] = lt;
 
-        advance(OPL);
+        advance(OPL, idle);
+    }
+}
+
+/* when set, every update is also rendered on a copy of the chip without
+   skipping idle channels, and differences are counted */
+int YM3812Verify = 0;
+unsigned YM3812Mismatches = 0;
+
+/*
+** Generate samples for one of the YM3812's
+**
+** 'which' is the virtual YM3812 number
+** '*buffer' is the output buffer pointer
+** 'length' is the number of samples that should be generated
+*/
+void YM3812UpdateOne(int which, INT16 *buffer, int length)
+{
+    FM_OPL      *OPL = OPL_YM3812[which];
+    FM_OPL      *ref = NULL;
+    OPLSAMPLE   *refbuf = NULL;
+
+    if( YM3812Verify )
+    {
+        ref = (FM_OPL *)malloc(sizeof(FM_OPL));
+        refbuf = (OPLSAMPLE *)malloc(length * 2 * sizeof(OPLSAMPLE));
+        if( ref && refbuf )
+        {
+            *ref = *OPL;
+            OPLRender(ref, refbuf, length, 0);
+        }
     }
 
+    OPLRender(OPL, buffer, length, OPLIdleChannels(OPL));
+
+    if( ref && refbuf && memcmp(buffer, refbuf, length * 2 * sizeof(OPLSAMPLE)) )
+    {
+        if( !YM3812Mismatches++ )
+            printf("YM3812UpdateOne: chip %d differs from the reference\n", which);
+    }
+    free(ref);
+    free(refbuf);
 }
 #endif /* BUILD_YM3812 */
@@ -43,6 +43,9 @@ void YM3812Mute(int which,int channel,BOOL mute);
 int  YM3812TimerOver(int which, int c);
 void YM3812UpdateOne(int which, INT16 *buffer, int length);
 
+extern int      YM3812Verify;       /* compare against the full render */
+extern unsigned YM3812Mismatches;
+
 void YM3812SetTimerHandler(int which, OPL_TIMERHANDLER TimerHandler, int channelOffset);
 void YM3812SetIRQHandler(int which, OPL_IRQHANDLER IRQHandler, int param);
 void YM3812SetUpdateHandler(int which, OPL_UPDATEHANDLER UpdateHandler, int param);
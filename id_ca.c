@@ -65,6 +65,17 @@ static maptype* mapheaderseg[NUMMAPS];
 byte    *audiosegs[NUMSNDCHUNKS];
 byte    *grsegs[NUMCHUNKS];
 
+/* allocated size of each cached chunk, for CA_ResidentBytes */
+static int32_t audiosegsize[NUMSNDCHUNKS];
+static int32_t grsegsize[NUMCHUNKS];
+
+/* the PC and AdLib sound effects each live in one block, built once */
+#define SOUNDBANKS      2
+#define SOUNDBANKALIGN  4
+
+static byte    *soundbank[SOUNDBANKS];
+static int32_t  soundbanksize[SOUNDBANKS];
+
 word    RLEWtag;
 
 int     numEpisodesMissing = 0;
@@ -393,7 +404,7 @@ int32_t CA_RLEWCompress (word *source, int32_t length, word *dest, word rlewtag)
 ======================
 */
 
-void CA_RLEWexpand (word *source, word *dest, int32_t length, word rlewtag)
+void CA_RLEWexpand (const word *source, word *dest, int32_t length, word rlewtag)
 {
    word value,count,i;
    word *end=dest+length/2;
@@ -711,20 +722,45 @@ void CA_Shutdown (void)
         UNCACHEGRCHUNK(i);
     free(pictable);
 
-    switch(oldsoundmode)
+    /* the sound effects point into their banks */
+    for(i=0; i<SOUNDBANKS; i++)
     {
-        case SDM_OFF:
-            return;
-        case SDM_PC:
-            start = STARTPCSOUNDS;
-            break;
-        case SDM_ADLIB:
-            start = STARTADLIBSOUNDS;
-            break;
+        start = i ? STARTADLIBSOUNDS : STARTPCSOUNDS;
+        if(soundbank[i])
+            memset(&audiosegs[start], 0, NUMSOUNDS * sizeof(audiosegs[0]));
+        free(soundbank[i]);
+        soundbank[i] = NULL;
+        soundbanksize[i] = 0;
     }
+}
 
-    for(i=0; i<NUMSOUNDS; i++,start++)
-        UNCACHEAUDIOCHUNK(start);
+/*
+======================
+=
+= CA_ResidentBytes
+=
+= Cached graphics, audio chunks and map planes
+=
+======================
+*/
+
+int32_t CA_ResidentBytes (void)
+{
+    int     i;
+    int32_t bytes = MAPPLANES*maparea*2;
+
+    for(i=0; i<NUMCHUNKS; i++)
+        if(grsegs[i])
+            bytes += grsegsize[i];
+
+    for(i=0; i<NUMSNDCHUNKS; i++)
+        if(audiosegs[i])
+            bytes += audiosegsize[i];
+
+    for(i=0; i<SOUNDBANKS; i++)
+        bytes += soundbanksize[i];
+
+    return bytes;
 }
 
 //===========================================================================
@@ -748,6 +784,7 @@ int32_t CA_CacheAudioChunk (int chunk)
 
     audiosegs[chunk]=(byte *) malloc(size);
     CHECKMALLOCRESULT(audiosegs[chunk]);
+    audiosegsize[chunk]=size;
 
     lseek(audiohandle,pos,SEEK_SET);
     read(audiohandle,audiosegs[chunk],size);
@@ -755,22 +792,20 @@ int32_t CA_CacheAudioChunk (int chunk)
     return size;
 }
 
-void CA_CacheAdlibSoundChunk (int chunk)
-{
-    int32_t pos  = Retro_SwapLES32(audiostarts[chunk]);
-    int32_t size = Retro_SwapLES32(audiostarts[chunk+1]) - pos;
-
-    /* already in memory */
-    if (audiosegs[chunk])
-        return;                        
-
-    lseek(audiohandle, pos, SEEK_SET);
-    read(audiohandle, bufferseg, ORIG_ADLIBSOUND_SIZE - 1);   /* without data[1] */
+/*
+======================
+=
+= CAL_UnpackAdlibSound
+=
+= Expands the packed header of an AdLib sound effect in audiot
+=
+======================
+*/
 
-    AdLibSound *sound = (AdLibSound *) malloc(size + sizeof(AdLibSound) - ORIG_ADLIBSOUND_SIZE);
-    CHECKMALLOCRESULT(sound);
+static void CAL_UnpackAdlibSound (byte *ptr, int32_t size, AdLibSound *sound)
+{
+    byte *data = ptr + ORIG_ADLIBSOUND_SIZE - 1;
 
-    byte *ptr = (byte *) bufferseg;
     sound->common.length = READLONGWORD(&ptr);
     sound->common.priority = READWORD(&ptr);
     sound->inst.mChar = *ptr++;
@@ -791,69 +826,94 @@ void CA_CacheAdlibSoundChunk (int chunk)
     sound->inst.unused[2] = *ptr++;
     sound->block = *ptr++;
 
-    read(audiohandle, sound->data, size - ORIG_ADLIBSOUND_SIZE + 1);  /* + 1 because of byte data[1] */
-
-    audiosegs[chunk]=(byte *) sound;
+    memcpy(sound->data, data, size - ORIG_ADLIBSOUND_SIZE + 1);  /* + 1 because of byte data[1] */
 }
 
-//===========================================================================
-
 /*
 ======================
 =
-= CA_LoadAllSounds
+= CAL_BuildSoundBank
 =
-= Purges all sounds, then loads all new ones (mode switch)
+= Reads all PC or AdLib sound effects with one read and lays them out,
+= unpacked and aligned, in a single block. audiosegs point into it.
 =
 ======================
 */
 
-void CA_LoadAllSounds (void)
+static void CAL_BuildSoundBank (int start)
 {
-    unsigned start,i;
+    int      bank = (start == STARTADLIBSOUNDS);
+    int32_t  first = Retro_SwapLES32(audiostarts[start]);
+    int32_t  last  = Retro_SwapLES32(audiostarts[start+NUMSOUNDS]);
+    int32_t  offs[NUMSOUNDS];
+    int32_t  total = 0;
+    byte    *file;
+    int      i;
+
+    if (soundbank[bank])
+        return;
 
-    switch (oldsoundmode)
+    for (i=0;i<NUMSOUNDS;i++)
     {
-        case SDM_OFF:
-            goto cachein;
-        case SDM_PC:
-            start = STARTPCSOUNDS;
-            break;
-        case SDM_ADLIB:
-            start = STARTADLIBSOUNDS;
-            break;
-    }
+        int32_t size = Retro_SwapLES32(audiostarts[start+i+1])
+            - Retro_SwapLES32(audiostarts[start+i]);
 
-    for (i=0;i<NUMSOUNDS;i++,start++)
-        UNCACHEAUDIOCHUNK(start);
+        if (bank)
+        {
+            if (size < ORIG_ADLIBSOUND_SIZE - 1)
+                Quit ("CAL_BuildSoundBank: AdLib sound %i is truncated", i);
+            size += sizeof(AdLibSound) - ORIG_ADLIBSOUND_SIZE;
+        }
+        offs[i] = total;
+        total += (size + SOUNDBANKALIGN - 1) & ~(SOUNDBANKALIGN - 1);
+    }
 
-cachein:
+    file = (byte *) malloc(last - first);
+    CHECKMALLOCRESULT(file);
+    soundbank[bank] = (byte *) malloc(total);
+    CHECKMALLOCRESULT(soundbank[bank]);
+    soundbanksize[bank] = total;
 
-    oldsoundmode = SoundMode;
+    lseek(audiohandle, first, SEEK_SET);
+    read(audiohandle, file, last - first);
 
-    switch (SoundMode)
+    for (i=0;i<NUMSOUNDS;i++)
     {
-        case SDM_OFF:
-            start = STARTADLIBSOUNDS;   /* needed for priorities... */
-            break;
-        case SDM_PC:
-            start = STARTPCSOUNDS;
-            break;
-        case SDM_ADLIB:
-            start = STARTADLIBSOUNDS;
-            break;
-    }
+        int32_t pos  = Retro_SwapLES32(audiostarts[start+i]);
+        int32_t size = Retro_SwapLES32(audiostarts[start+i+1]) - pos;
+        byte   *dest = soundbank[bank] + offs[i];
 
-    if(start == STARTADLIBSOUNDS)
-    {
-        for (i=0;i<NUMSOUNDS;i++,start++)
-            CA_CacheAdlibSoundChunk(start);
+        if (bank)
+            CAL_UnpackAdlibSound(file + pos - first, size, (AdLibSound *) dest);
+        else
+            memcpy(dest, file + pos - first, size);
+        audiosegs[start+i] = dest;
     }
+
+    free(file);
+}
+
+//===========================================================================
+
+/*
+======================
+=
+= CA_LoadAllSounds
+=
+= Makes the sound effects of the current mode available. Each bank is
+= built on first use and kept, so a mode switch only swaps SoundTable.
+=
+======================
+*/
+
+void CA_LoadAllSounds (void)
+{
+    oldsoundmode = SoundMode;
+
+    if (SoundMode == SDM_PC)
+        CAL_BuildSoundBank(STARTPCSOUNDS);
     else
-    {
-        for (i=0;i<NUMSOUNDS;i++,start++)
-            CA_CacheAudioChunk(start);
-    }
+        CAL_BuildSoundBank(STARTADLIBSOUNDS);   /* needed for priorities... */
 }
 
 //===========================================================================
@@ -869,7 +929,7 @@ cachein:
 ======================
 */
 
-void CAL_ExpandGrChunk (int chunk, int32_t *source)
+static int32_t CAL_ExpandedGrSize (int chunk, int32_t **source)
 {
     int32_t    expanded;
 
@@ -898,14 +958,23 @@ void CAL_ExpandGrChunk (int chunk, int32_t *source)
     else
     {
         /* everything else has an explicit size longword */
-        expanded = Retro_SwapLES32(*source++);
+        expanded = Retro_SwapLES32(**source);
+        (*source)++;
     }
 
+    return expanded;
+}
+
+void CAL_ExpandGrChunk (int chunk, int32_t *source)
+{
+    int32_t    expanded = CAL_ExpandedGrSize(chunk, &source);
+
     /*
      * allocate final space, decompress it, and free bigbuffer.
      * Sprites need to have shifts made and various other junk. */
     grsegs[chunk]=(byte *) malloc(expanded);
     CHECKMALLOCRESULT(grsegs[chunk]);
+    grsegsize[chunk]=expanded;
     CAL_HuffExpand((byte *) source, grsegs[chunk], expanded, grhuffman);
 }
 
@@ -928,7 +997,11 @@ void CA_CacheGrChunk (int chunk)
 
    /* already in memory */
    if (grsegs[chunk])
+   {
+      STGame.cachehits++;
       return;
+   }
+   STGame.cachemisses++;
 
    /* load the chunk into a buffer, 
     * either the miscbuffer if it fits, or allocate
@@ -1034,6 +1107,21 @@ void CA_CacheScreen (int chunk)
 
 //==========================================================================
 
+/*
+======================
+=
+= CA_MapPresent
+=
+= False for the sparse entries of the map header
+=
+======================
+*/
+
+boolean CA_MapPresent (int mapnum)
+{
+   return mapnum >= 0 && mapnum < NUMMAPS && mapheaderseg[mapnum] != NULL;
+}
+
 /*
 ======================
 =
@@ -1114,3 +1202,250 @@ void CA_CannotOpen(const char *string)
     strcat(str,"!\n");
     Quit (str);
 }
+
+//===========================================================================
+
+/*
+======================
+=
+= CA_BenchReport
+=
+= One line of the decode bench: throughput over the expanded bytes, time
+= per item and a checksum of the output, so that builds from different
+= compilers can be compared
+=
+======================
+*/
+
+void CA_BenchReport (const char *name, int items, int32_t bytes, int runs,
+    uint32_t usec, longword sum)
+{
+    if (!usec)
+        usec = 1;
+    printf ("%-10s %5d items %9d bytes %8.1f MB/s %9.0f ns/item  sum %08x\n",
+        name, items, bytes, (double) bytes * runs / usec,
+        (double) usec * 1000 / ((double) items * runs), sum);
+}
+
+/*
+======================
+=
+= CA_Hash
+=
+= FNV-1a over length bytes, continuing from hash. Start with CA_HASHSEED.
+= Used for the bench checksums and to tell music cache files apart.
+=
+======================
+*/
+
+longword CA_Hash (longword hash, const void *data, int32_t length)
+{
+    const byte *src = (const byte *) data;
+
+    while (length-- > 0)
+        hash = (hash ^ *src++) * 16777619u;
+    return hash;
+}
+
+/*
+======================
+=
+= CA_DecodeBench
+=
+= Runs the decoders over the whole data set, runs times each: every
+= graphics chunk through CAL_HuffExpand, every map plane through
+= CAL_CarmackExpand and CA_RLEWexpand, and every picture through
+= VL_MemToLatch. The compressed data is read up front, so only the
+= decoding is timed.
+=
+======================
+*/
+
+void CA_DecodeBench (int runs)
+{
+    byte       *graph, *dest, *pics[NUMPICS];
+    word       *packed[NUMMAPS*MAPPLANES], *rlew, *plane;
+    int32_t    *source;
+    int32_t     length, expanded, maxexpanded, bytes;
+    int         chunk, next, map, i, run, items;
+    uint32_t    start, usec;
+    longword    sum;
+    LR_Surface  latch;
+
+    //
+    // graphics: the whole file, then every chunk through the huffman tree
+    //
+    length = GRFILEPOS(NUMCHUNKS);
+    graph = (byte *) malloc(length);
+    CHECKMALLOCRESULT(graph);
+    lseek(grhandle, 0, SEEK_SET);
+    if (read(grhandle, graph, length) != length)
+        Quit("CA_DecodeBench: Can't read the graphics file!");
+
+    maxexpanded = 0;
+    for (chunk = 0; chunk < NUMCHUNKS; chunk++)
+    {
+        if (GRFILEPOS(chunk) < 0)
+            continue;
+        source = (int32_t *) (graph + GRFILEPOS(chunk));
+        expanded = CAL_ExpandedGrSize(chunk, &source);
+        if (expanded > maxexpanded)
+            maxexpanded = expanded;
+    }
+    dest = (byte *) malloc(maxexpanded);
+    CHECKMALLOCRESULT(dest);
+
+    usec = 0;
+    for (run = 0; run < runs; run++)
+    {
+        items = bytes = 0;
+        sum = CA_HASHSEED;
+        for (chunk = 0; chunk < NUMCHUNKS; chunk++)
+        {
+            if (GRFILEPOS(chunk) < 0)
+                continue;
+            next = chunk + 1;
+            while (next < NUMCHUNKS && GRFILEPOS(next) == -1)
+                next++;
+            source = (int32_t *) (graph + GRFILEPOS(chunk));
+            expanded = CAL_ExpandedGrSize(chunk, &source);
+            if (expanded <= 0 || GRFILEPOS(next) <= GRFILEPOS(chunk))
+                continue;
+
+            start = LR_GetMicroTicks();
+            CAL_HuffExpand((byte *) source, dest, expanded, grhuffman);
+            usec += LR_GetMicroTicks() - start;
+
+            sum = CA_Hash(sum, dest, expanded);
+            items++;
+            bytes += expanded;
+        }
+    }
+    CA_BenchReport("huffman", items, bytes, runs, usec, sum);
+
+    //
+    // pictures: de-planarize each into a latch sized surface
+    //
+    for (i = 0; i < NUMPICS; i++)
+    {
+        source = (int32_t *) (graph + GRFILEPOS(STARTPICS + i));
+        expanded = CAL_ExpandedGrSize(STARTPICS + i, &source);
+        pics[i] = (byte *) malloc(expanded);
+        CHECKMALLOCRESULT(pics[i]);
+        CAL_HuffExpand((byte *) source, pics[i], expanded, grhuffman);
+    }
+    free(dest);
+    free(graph);
+
+    latch.surf = LR_CreateRGBSurface(SDL_SWSURFACE, 320, 200, 8, 0, 0, 0, 0);
+    if (!latch.surf)
+        Quit("CA_DecodeBench: Unable to create latch surface!");
+
+    usec = 0;
+    for (run = 0; run < runs; run++)
+    {
+        items = bytes = 0;
+        sum = CA_HASHSEED;
+        for (i = 0; i < NUMPICS; i++)
+        {
+            start = LR_GetMicroTicks();
+            VL_MemToLatch(pics[i], pictable[i].width, pictable[i].height, &latch, 0, 0);
+            usec += LR_GetMicroTicks() - start;
+
+            sum = CA_Hash(sum, latch.surf->pixels,
+                latch.surf->pitch * pictable[i].height);
+            items++;
+            bytes += pictable[i].width * pictable[i].height;
+        }
+    }
+    CA_BenchReport("latch", items, bytes, runs, usec, sum);
+
+    LR_FreeSurface(latch.surf);
+    for (i = 0; i < NUMPICS; i++)
+        free(pics[i]);
+
+    //
+    // maps: carmack, then RLEW of every plane
+    //
+    items = 0;
+    for (map = 0; map < NUMMAPS; map++)
+    {
+        if (!CA_MapPresent(map))
+            continue;
+        for (i = 0; i < MAPPLANES; i++)
+        {
+            length = mapheaderseg[map]->planelength[i];
+            packed[items] = (word *) malloc(length);
+            CHECKMALLOCRESULT(packed[items]);
+            lseek(maphandle, mapheaderseg[map]->planestart[i], SEEK_SET);
+            if (read(maphandle, packed[items], length) != length)
+                Quit("CA_DecodeBench: Can't read map %d!", map);
+            items++;
+        }
+    }
+
+    plane = (word *) malloc(maparea * 2);
+    CHECKMALLOCRESULT(plane);
+#ifdef CARMACIZED
+    maxexpanded = 0;
+    for (i = 0; i < items; i++)
+    {
+        expanded = Retro_SwapLES16(packed[i][0]);
+        if (expanded > maxexpanded)
+            maxexpanded = expanded;
+    }
+    rlew = (word *) malloc(maxexpanded);
+    CHECKMALLOCRESULT(rlew);
+
+    usec = 0;
+    for (run = 0; run < runs; run++)
+    {
+        bytes = 0;
+        sum = CA_HASHSEED;
+        for (i = 0; i < items; i++)
+        {
+            expanded = Retro_SwapLES16(packed[i][0]);
+
+            start = LR_GetMicroTicks();
+            CAL_CarmackExpand((byte *) (packed[i] + 1), rlew, expanded);
+            usec += LR_GetMicroTicks() - start;
+
+            sum = CA_Hash(sum, (byte *) rlew, expanded);
+            bytes += expanded;
+        }
+    }
+    CA_BenchReport("carmack", items, bytes, runs, usec, sum);
+#endif
+
+    usec = 0;
+    for (run = 0; run < runs; run++)
+    {
+        bytes = 0;
+        sum = CA_HASHSEED;
+        for (i = 0; i < items; i++)
+        {
+#ifdef CARMACIZED
+            CAL_CarmackExpand((byte *) (packed[i] + 1), rlew,
+                Retro_SwapLES16(packed[i][0]));
+
+            start = LR_GetMicroTicks();
+            CA_RLEWexpand(rlew + 1, plane, maparea * 2, RLEWtag);
+#else
+            start = LR_GetMicroTicks();
+            CA_RLEWexpand(packed[i] + 1, plane, maparea * 2, RLEWtag);
+#endif
+            usec += LR_GetMicroTicks() - start;
+
+            sum = CA_Hash(sum, (byte *) plane, maparea * 2);
+            bytes += maparea * 2;
+        }
+    }
+    CA_BenchReport("rlew", items, bytes, runs, usec, sum);
+
+#ifdef CARMACIZED
+    free(rlew);
+#endif
+    free(plane);
+    for (i = 0; i < items; i++)
+        free(packed[i]);
+}
@@ -38,7 +38,7 @@ boolean CA_WriteFile (const char *filename, void *ptr, int32_t length);
 
 int32_t CA_RLEWCompress (word *source, int32_t length, word *dest, word rlewtag);
 
-void CA_RLEWexpand (word *source, word *dest, int32_t length, word rlewtag);
+void CA_RLEWexpand (const word *source, word *dest, int32_t length, word rlewtag);
 
 void CA_Startup (void);
 void CA_Shutdown (void);
@@ -48,9 +48,20 @@ void CA_LoadAllSounds (void);
 
 void CA_CacheGrChunk (int chunk);
 void CA_CacheMap (int mapnum);
+boolean CA_MapPresent (int mapnum);
 
 void CA_CacheScreen (int chunk);
 
 void CA_CannotOpen(const char *name);
 
+int32_t CA_ResidentBytes (void);
+
+#define CA_HASHSEED     2166136261u
+
+longword CA_Hash (longword hash, const void *data, int32_t length);
+
+void CA_DecodeBench (int runs);
+void CA_BenchReport (const char *name, int items, int32_t bytes, int runs,
+    uint32_t usec, longword sum);
+
 #endif
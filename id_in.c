@@ -498,7 +498,7 @@ boolean IN_UserInput(longword delay)
       IN_ProcessEvents();
       if (IN_CheckAck())
          return true;
-      rarch_sleep(5);
+      LR_Delay(5);
    } while (GetTimeCount() - lasttime < delay);
    return(false);
 }
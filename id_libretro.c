@@ -5,20 +5,62 @@
 #include "surface.h"
 
 LR_Color curpal[256];
+unsigned short d_8to16table[256];
+
+static boolean presentheld;
+
+static void VL_ExpandPalette(LR_Color *palette)
+{
+   int i;
+
+   for (i = 0; i < 256; i++)
+      d_8to16table[i] = MAKECOLOR(palette[i].r, palette[i].g, palette[i].b);
+}
 
 void VL_WaitVBL(int vbls)
 {
-   rarch_sleep(vbls * 8);
+   if (speculative)
+      return;
+   LR_Delay(vbls * 8);
 }
 
 void VW_UpdateScreen(void)
 {
-   VL_ScreenToScreen(screenBuffer, screen);
+   if (speculative)
+   {
+      // shown only if the frame is committed
+      presentheld = true;
+      return;
+   }
 #ifdef __LIBRETRO__
-   LR_Flip(NULL);
+   // expand straight into the frontend's framebuffer, no screen surface
+   LR_Present(screenBuffer, d_8to16table);
 #else
+   VL_ScreenToScreen(screenBuffer, screen);
    LR_Flip(screen);
 #endif
+   // FizzleFade starts from the frame on display
+   memcpy(shownBuffer->surf->pixels, screenBuffer->surf->pixels,
+         bufferPitch * screenHeight);
+}
+
+/*
+=======================
+=
+= VL_ReleasePresent
+=
+= Shows or forgets the last present of a speculative frame
+=
+=======================
+*/
+
+void VL_ReleasePresent(boolean show)
+{
+   boolean held = presentheld;
+
+   presentheld = false;
+   if (held && show)
+      VW_UpdateScreen();
 }
 
 /*
@@ -42,6 +84,7 @@ void    VL_Startup (void)
    LR_SetColors(screen->surf, gamepal, 0, 256);
 #endif
    memcpy(curpal, gamepal, sizeof(LR_Color) * 256);
+   VL_ExpandPalette(curpal);
 
    screenBuffer = (LR_Surface*)calloc(1, sizeof(*screenBuffer));
 
@@ -51,6 +94,13 @@ void    VL_Startup (void)
       exit(1);
    LR_SetColors(screenBuffer->surf, gamepal, 0, 256);
 
+   shownBuffer = (LR_Surface*)calloc(1, sizeof(*shownBuffer));
+
+   shownBuffer->surf = LR_CreateRGBSurface(SDL_SWSURFACE, screenWidth,
+         screenHeight, 8, 0, 0, 0, 0);
+   if(!shownBuffer->surf)
+      exit(1);
+
    bufferPitch = screenBuffer->surf->pitch;
    scaleFactor = screenWidth/320;
 
@@ -74,6 +124,11 @@ void VL_Shutdown (void)
 {
    if (screenBuffer)
       free(screenBuffer);
+   if (shownBuffer)
+   {
+      LR_FreeSurface(shownBuffer->surf);
+      free(shownBuffer);
+   }
 #ifndef __LIBRETRO__
    if (screen)
       free(screen);
@@ -81,6 +136,7 @@ void VL_Shutdown (void)
    screen       = NULL;
 #endif
    screenBuffer = NULL;
+   shownBuffer  = NULL;
 }
 
 /*
@@ -94,6 +150,7 @@ void VL_Shutdown (void)
 void VL_SetPalette (LR_Color *palette, bool forceupdate)
 {
    memcpy(curpal, palette, sizeof(LR_Color) * 256);
+   VL_ExpandPalette(curpal);
 
    LR_SetPalette(screenBuffer->surf, SDL_LOGPAL, palette, 0, 256);
    if (forceupdate)
@@ -0,0 +1,127 @@
+// ID_MM.C
+
+#include "wl_def.h"
+
+/*
+=============================================================================
+
+                             GLOBAL VARIABLES
+
+=============================================================================
+*/
+
+longword    MMBudget;
+boolean     MMReport;
+int         MMLevel;
+
+static int  MMMissedLevel = -1;     // last level told it doesn't fit
+
+
+/*
+======================
+=
+= MM_Resident
+=
+= Bytes held by the page, sound and cache managers
+=
+======================
+*/
+
+int32_t MM_Resident (void)
+{
+   return PM_ResidentBytes () + SD_ResidentBytes () + CA_ResidentBytes ();
+}
+
+
+/*
+======================
+=
+= MM_OverBudget
+=
+= True if loading extra bytes more would go over the budget
+=
+======================
+*/
+
+boolean MM_OverBudget (int32_t extra)
+{
+   if (!MMBudget)
+      return false;
+
+   return (longword) (MM_Resident () + extra) > MMBudget;
+}
+
+
+/*
+======================
+=
+= MM_BudgetMissed
+=
+= Called when nothing outside the current working set is left to free
+= and extra bytes still don't fit. They are loaded anyway; this says so
+= once per level instead of throwing the working set out.
+=
+======================
+*/
+
+void MM_BudgetMissed (int32_t extra)
+{
+   if (MMMissedLevel == MMLevel)
+      return;
+   MMMissedLevel = MMLevel;
+
+   printf ("Memory (level %i): the working set does not fit, %i bytes over the budget of %u\n",
+         MMLevel, (int32_t) (MM_Resident () + extra - MMBudget), MMBudget);
+}
+
+
+/*
+======================
+=
+= MM_Report
+=
+= Prints the resident bytes per subsystem and what the current level has
+= touched so far
+=
+======================
+*/
+
+void MM_Report (void)
+{
+   int     textures, sprites, sounds;
+   int32_t pagebytes, soundbytes;
+
+   PM_LevelWorkingSet (&textures, &sprites, &pagebytes);
+   SD_LevelWorkingSet (&sounds, &soundbytes);
+
+   printf ("Memory (level %i): pages %i, sounds %i, cache %i, total %i",
+         MMLevel, PM_ResidentBytes (), SD_ResidentBytes (),
+         CA_ResidentBytes (), MM_Resident ());
+   if (MMBudget)
+      printf (" of %u", MMBudget);
+   printf ("\n");
+
+   printf ("Working set (level %i): %i textures, %i sprites (%i bytes), "
+         "%i sounds (%i bytes)\n",
+         MMLevel, textures, sprites, pagebytes, sounds, soundbytes);
+}
+
+
+/*
+======================
+=
+= MM_NewLevel
+=
+= Reports on the level that ends and starts a new working set. Pages and
+= sounds used since are pinned until the next level change.
+=
+======================
+*/
+
+void MM_NewLevel (void)
+{
+   if (MMReport && MMLevel)
+      MM_Report ();
+
+   MMLevel++;
+}
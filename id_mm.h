@@ -0,0 +1,20 @@
+// ID_MM.H
+//
+// Memory accounting. Tracks what the page manager, the sound manager and
+// the cache manager keep resident, the per level working set, and an
+// optional budget the page and sound managers page against.
+
+#ifndef __ID_MM__
+#define __ID_MM__
+
+extern  longword    MMBudget;       // bytes, 0 = everything stays resident
+extern  boolean     MMReport;       // print a report at every level change
+extern  int         MMLevel;        // bumped on every level start
+
+int32_t MM_Resident (void);
+boolean MM_OverBudget (int32_t extra);
+void    MM_BudgetMissed (int32_t extra);
+void    MM_NewLevel (void);
+void    MM_Report (void);
+
+#endif
@@ -16,6 +16,16 @@ size_t PMPageDataSize;
  * The last pointer points one byte after the last page.
  */
 uint8_t **PMPages;
+uint32_t *PMPageSizes;
+int *PMPageLevel;
+
+/* budget mode: pages are read from the still open VSWAP on demand */
+static FILE *PMFile;
+static uint32_t *PMPageOffsets;
+static int32_t PMResident;
+static uint32_t PMEmptyPage;        /* what sparse pages point to */
+static byte *PMSoundData;           /* contiguous copy of the last sound */
+static int32_t PMSoundDataSize;
 
 void PM_Startup(void)
 {
@@ -86,6 +96,36 @@ void PM_Startup(void)
                i, pageOffsets[i], fileSize);
    }
 
+   PMPageSizes = (uint32_t *) malloc(ChunksInFile * sizeof(uint32_t));
+   CHECKMALLOCRESULT(PMPageSizes);
+   PMPageLevel = (int *) calloc(ChunksInFile, sizeof(int));
+   CHECKMALLOCRESULT(PMPageLevel);
+
+   PMPages = (uint8_t **) malloc((ChunksInFile + 1) * sizeof(uint8_t *));
+   CHECKMALLOCRESULT(PMPages);
+
+   if(MMBudget)
+   {
+      /* Only remember where the pages are, PM_LoadPage reads them.
+       * malloc keeps every page 2-byte aligned, so no padding. */
+      for(i = 0; i < ChunksInFile; i++)
+      {
+         if(!pageOffsets[i])
+            PMPageSizes[i] = 0;
+         else if(!pageOffsets[i + 1])
+            PMPageSizes[i] = pageLengths[i];
+         else
+            PMPageSizes[i] = pageOffsets[i + 1] - pageOffsets[i];
+         PMPages[i] = NULL;
+      }
+      PMPages[ChunksInFile] = NULL;
+
+      PMPageOffsets = pageOffsets;
+      PMFile        = file;
+      free(pageLengths);
+      return;
+   }
+
    /* Calculate total amount of padding needed for sprites and sound info page */
    for(i = PMSpriteStart; i < PMSoundStart; i++)
    {
@@ -107,9 +147,6 @@ void PM_Startup(void)
    PMPageData = (uint32_t *) malloc(PMPageDataSize);
    CHECKMALLOCRESULT(PMPageData);
 
-   PMPages = (uint8_t **) malloc((ChunksInFile + 1) * sizeof(uint8_t *));
-   CHECKMALLOCRESULT(PMPages);
-
    /* Load pages and initialize PMPages pointers */
    ptr = (uint8_t *) PMPageData;
 
@@ -150,6 +187,9 @@ void PM_Startup(void)
    /* last page points after page buffer */
    PMPages[ChunksInFile] = ptr;
 
+   for(i = 0; i < ChunksInFile; i++)
+      PMPageSizes[i] = (uint32_t) (PMPages[i + 1] - PMPages[i]);
+
    free(pageLengths);
    free(pageOffsets);
    fclose(file);
@@ -157,6 +197,141 @@ void PM_Startup(void)
 
 void PM_Shutdown(void)
 {
+   int i;
+
+   if(PMFile)
+   {
+      for(i = 0; i < ChunksInFile; i++)
+      {
+         if(PMPages[i] && PMPageSizes[i])
+            free(PMPages[i]);
+      }
+      free(PMPageOffsets);
+      free(PMSoundData);
+      fclose(PMFile);
+      PMFile = NULL;
+   }
+
    free(PMPages);
+   free(PMPageSizes);
+   free(PMPageLevel);
    free(PMPageData);
 }
+
+/*
+ * Frees the resident page that was used longest ago.
+ * Pages of the current level's working set are pinned.
+ */
+static boolean PM_EvictPage(int keep)
+{
+   int i, victim = -1;
+
+   for(i = 0; i < ChunksInFile; i++)
+   {
+      if(i == keep || !PMPages[i] || !PMPageSizes[i] || PMPageLevel[i] == MMLevel)
+         continue;
+      if(victim == -1 || PMPageLevel[i] < PMPageLevel[victim])
+         victim = i;
+   }
+
+   if(victim == -1)
+      return false;
+
+   free(PMPages[victim]);
+   PMPages[victim] = NULL;
+   PMResident     -= PMPageSizes[victim];
+   return true;
+}
+
+uint8_t *PM_LoadPage(int page)
+{
+   uint8_t *data;
+   uint32_t size = PMPageSizes[page];
+
+   if(!size)
+      return PMPages[page] = (uint8_t *) &PMEmptyPage;
+
+   while(MM_OverBudget(size))
+   {
+      if(!PM_EvictPage(page))
+      {
+         MM_BudgetMissed(size);
+         break;
+      }
+   }
+
+   data = (uint8_t *) malloc(size);
+   CHECKMALLOCRESULT(data);
+
+   fseek(PMFile, PMPageOffsets[page], SEEK_SET);
+   if(fread(data, 1, size, PMFile) != size)
+      Quit("PM_LoadPage: Unable to read page %i!", page);
+
+   PMPages[page] = data;
+   PMResident   += size;
+   return data;
+}
+
+/*
+ * Returns size bytes of digitized sound starting at the given
+ * sound page. Sounds span several pages, so in budget mode they
+ * are read into a buffer that stays valid until the next call.
+ */
+byte *PM_GetSoundData(int soundpagenum, int32_t size)
+{
+   int page = PMSoundStart + soundpagenum;
+   byte *data;
+
+   if(!PMFile)
+   {
+      data = PM_GetSound(soundpagenum);
+      if(data + size >= PMPages[ChunksInFile])
+         Quit("PM_GetSoundData(%i): Sound reaches out of page file!\n", soundpagenum);
+      return data;
+   }
+
+   if(page < 0 || page >= ChunksInFile
+         || PMPageOffsets[page] + size >= PMPageOffsets[ChunksInFile])
+      Quit("PM_GetSoundData(%i): Sound reaches out of page file!\n", soundpagenum);
+
+   if(size > PMSoundDataSize)
+   {
+      free(PMSoundData);
+      PMSoundData = (byte *) malloc(size);
+      CHECKMALLOCRESULT(PMSoundData);
+      PMSoundDataSize = size;
+   }
+
+   fseek(PMFile, PMPageOffsets[page], SEEK_SET);
+   if(fread(PMSoundData, 1, size, PMFile) != (size_t) size)
+      Quit("PM_GetSoundData(%i): Unable to read sound!", soundpagenum);
+
+   return PMSoundData;
+}
+
+int32_t PM_ResidentBytes(void)
+{
+   if(!PMFile)
+      return (int32_t) PMPageDataSize;
+   return PMResident + PMSoundDataSize;
+}
+
+/* Counts the textures and sprites used since the level started */
+void PM_LevelWorkingSet(int *textures, int *sprites, int32_t *bytes)
+{
+   int i;
+
+   *textures = *sprites = 0;
+   *bytes    = 0;
+
+   for(i = 0; i < PMSoundStart; i++)
+   {
+      if(PMPageLevel[i] != MMLevel)
+         continue;
+      if(i < PMSpriteStart)
+         (*textures)++;
+      else
+         (*sprites)++;
+      *bytes += PMPageSizes[i];
+   }
+}
@@ -13,30 +13,41 @@ extern bool PMSoundInfoPagePadded;
 
 // ChunksInFile+1 pointers to page starts.
 // The last pointer points one byte after the last page.
+// With a memory budget (MMBudget) pages are loaded on demand
+// and a NULL pointer means the page is not resident.
 extern uint8_t **PMPages;
+extern uint32_t *PMPageSizes;
+
+// MMLevel of the level that last used each page, only kept up to date
+// with a memory budget or the memory report
+extern int *PMPageLevel;
 
 void PM_Startup(void);
 void PM_Shutdown(void);
 
+uint8_t *PM_LoadPage(int page);
+byte    *PM_GetSoundData(int soundpagenum, int32_t size);
+int32_t  PM_ResidentBytes(void);
+void     PM_LevelWorkingSet(int *textures, int *sprites, int32_t *bytes);
+
 static inline uint32_t PM_GetPageSize(int page)
 {
     if(page < 0 || page >= ChunksInFile)
         Quit("PM_GetPageSize: Tried to access illegal page: %i", page);
-    return (uint32_t) (PMPages[page + 1] - PMPages[page]);
+    return PMPageSizes[page];
 }
 
 static inline uint8_t *PM_GetPage(int page)
 {
     if(page < 0 || page >= ChunksInFile)
         Quit("PM_GetPage: Tried to access illegal page: %i", page);
+    if(MMBudget || MMReport)
+        PMPageLevel[page] = MMLevel;
+    if(!PMPages[page])
+        return PM_LoadPage(page);
     return PMPages[page];
 }
 
-static inline uint8_t *PM_GetEnd(void)
-{
-    return PMPages[ChunksInFile];
-}
-
 static inline byte *PM_GetTexture(int wallpic)
 {
     return PM_GetPage(wallpic);
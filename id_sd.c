@@ -27,6 +27,12 @@
 //                      NeedsMusic - load music?
 //
 
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
 #include "wl_def.h"
 #include <retro_endian.h>
 #include "SDL_mixer/SDL_mixer.h"
@@ -63,6 +69,8 @@ typedef struct
 
 static Mix_Chunk *SoundChunks[ STARTMUSIC - STARTDIGISOUNDS];
 static byte      *SoundBuffers[STARTMUSIC - STARTDIGISOUNDS];
+static int32_t    SoundBytes[  STARTMUSIC - STARTDIGISOUNDS];
+static int        SoundLevel[  STARTMUSIC - STARTDIGISOUNDS];   /* MMLevel of last use */
 
 globalsoundpos channelSoundPos[MIX_CHANNELS];
 
@@ -87,14 +95,73 @@ static  word                    SoundPriority;
 static  word                    DigiPriority;
 static  int                     LeftPosition;
 static  int                     RightPosition;
+static  boolean                 nextsoundorigin;
+static  fixed                   OriginX, OriginY;
+
+//      Sound and music calls of a speculative frame, see SD_CommitSounds
+#define HELDSOUNDS      16
+
+typedef enum
+{
+   HELD_SOUND,
+   HELD_STOPSOUND,
+   HELD_MUSICON,
+   HELD_MUSICOFF,
+   HELD_STARTMUSIC,
+   HELD_CONTINUEMUSIC
+} heldkind_t;
+
+typedef struct
+{
+   heldkind_t  kind;
+   int         chunk, startoffs;
+   soundnames  sound;
+   int         leftpos, rightpos;
+   boolean     positioned;
+   boolean     hasorigin;
+   fixed       originx, originy;
+} heldsound_t;
+
+static  heldsound_t             HeldSounds[HELDSOUNDS];
+static  int                     NumHeldSounds;
 
         word                    NumDigi;
 static  digiinfo               *DigiList;
 static  boolean                 DigiPlaying;
 
+//      Voice allocator variables
+//
+//      Channels 0 and 1 are reserved for the weapons, the rest are shared
+//      voices. Playing voices sit in a min heap on their weight, so the
+//      one to steal is always at the top. SD_ChannelFinished edits the heap
+//      from the mixer callback, so the game thread edits it under
+//      Mix_LockAudio.
+#define DIGIFIRSTVOICE  2
+#define DIGIVOICES      (MIX_CHANNELS - DIGIFIRSTVOICE)
+#define DIGIDISTWEIGHT  32              /* priority step over distance */
+
+typedef struct
+{
+   int32_t     weight;                  /* priority, less the distance */
+   longword    serial;                  /* play order, older goes first */
+} digivoice_t;
+
+static  digivoice_t             Voices[MIX_CHANNELS];
+static  int                     VoiceHeap[DIGIVOICES];
+static  int                     VoiceHeapPos[MIX_CHANNELS];
+static  int                     VoiceHeapSize;
+static  int                     FreeVoices[DIGIVOICES];
+static  int                     NumFreeVoices;
+static  longword                VoiceSerial;
+
 //      PC Sound variables
+#define PCTIMERCLOCK    1193181         /* 8253 input clock */
+#define PCVOLUME        5000
 
 static  byte * volatile         pcSound;
+static  longword                pcLengthLeft;
+static  float                   pcPhase;
+static  float                   pcPhaseStep;    /* cycles per sample, 0 if silent */
 
 
 //      AdLib variables
@@ -111,6 +178,164 @@ static  word                   *sqHackPtr;
 static  int                     sqHackLen;
 static  int                     sqHackSeqLen;
 static  longword                sqHackTime;
+static  longword                sqTicks;        /* ticks into the current pass */
+static  int                     sqChunk;
+
+//      Music seek variables
+//
+//      Seeking replays the register writes up to the new offset with notes
+//      masked. Every SNAPSHOTWRITES writes the resulting register file is
+//      kept, so a seek restores the nearest snapshot and replays the rest.
+#define SNAPSHOTWRITES  256
+
+typedef struct
+{
+   longword ticks;                      /* sequencer ticks up to here */
+   byte     regs[256];
+   byte     written[256/8];
+} oplsnapshot_t;
+
+static  oplsnapshot_t          *MusicSnapshots[LASTMUSIC];
+static  byte                    MusicRegsUsed[LASTMUSIC][256/8];        /* anywhere in the song */
+
+//      Music cache variables
+//
+//      IMF songs are fixed register streams, so each one is rendered once
+//      on the second OPL to mono PCM and streamed from then on. fmopl keeps
+//      its per-update state in file statics, so the render cannot run on a
+//      thread of its own; it runs at the end of the mixer callback instead,
+//      in a slice capped by both sample count and time so a song's first
+//      play never costs the callback more than MUSICCACHELOAD percent.
+//      Cache files are little-endian.
+//
+//      The cache stays off unless --musiccache asks for it: until a song
+//      has been rendered it costs the render on top of the live synthesis,
+//      and it only saves time once the song streams. Streaming a song while
+//      it renders, so the first play costs no more than live playback, is
+//      still to do. The game thread changes the entries and the pointers
+//      below only under Mix_LockAudio.
+#define MUSICCACHESONGS 3               /* songs kept rendered at once */
+#define MUSICCACHESPEED 4               /* render rate, at most times playback */
+#define MUSICCACHELOAD  20              /* render time, percent of a callback */
+#define MUSICCACHEMAGIC 0x43464d49      /* "IMFC" */
+#define MUSICCACHEHEAD  3               /* magic, hash, length */
+
+typedef struct
+{
+   int              chunk;              /* 0 if the slot is free */
+   word            *imf;                /* private copy of the register stream */
+   int              imflen;
+   longword        *file;               /* header followed by the samples */
+   INT16           *pcm;
+   int32_t          length;             /* loop length in samples */
+   volatile int32_t rendered;
+   boolean          saved;
+   longword         lastuse;
+} musiccache_t;
+
+        MCMode                  MusicCacheMode = MCM_OFF;
+static  musiccache_t            MusicCache[MUSICCACHESONGS];
+static  longword                mcUseCount;
+static  musiccache_t * volatile mcPlaying;      /* entry of the current song */
+static  volatile boolean        mcStreaming;    /* music comes from mcPlaying */
+static  int32_t                 mcPos;
+static  int32_t                 mcGain;
+static  int32_t                 mcGainStep;
+
+//      Streamed music that was turned off keeps playing here while it fades,
+//      so the next song crossfades with it instead of cutting in.
+#define MUSICUNITY          0x10000     /* 16.16 gain of 1 */
+#define MUSICFADESAMPLES    0x8000      /* 0.74 s, a whole step per sample */
+
+static  musiccache_t * volatile mcFading;
+static  int32_t                 mcFadePos;
+static  int32_t                 mcFadeGain;
+
+//      A song synthesized live on OPL 0 fades by raising the total level of
+//      its operators, so the sound effects on channel 0 keep their volume.
+//      It plays on from a copy of the sequencer until it is silent, the
+//      next song waits for it and then fades in the same way. Seeks are
+//      applied by the mixer callback, so they cannot land in a fade.
+#define LIVEFADESTEPS   63              /* total level steps of 0.75 dB */
+#define LIVEFADETICKS   8               /* music ticks per step, 0.72 s in all */
+
+static  volatile boolean        sqFading;       /* the last song is fading out */
+static  word                   *sqFadeHack;
+static  int                     sqFadeSeqLen;
+static  word                   *sqFadePtr;
+static  int                     sqFadeLen;
+static  longword                sqFadeTime;
+static  longword                sqFadeTimeCount;
+static  int                     sqFadeLevel;    /* ticks into the fade out */
+static  int                     sqInLevel;      /* ticks left of the fade in */
+static  byte                    sqRegs[256];    /* last values the music wrote */
+static  volatile boolean        sqSeekPending;
+static  byte                    sqSeekRegs[256];
+static  byte                   *sqSeekUsed;
+static  musiccache_t * volatile mcRender;       /* entry wanted on OPL 1 */
+static  musiccache_t           *mcCurrent;      /* entry OPL 1 is set up for */
+static  word                   *mcPtr;
+static  int                     mcLen;
+static  longword                mcTime;
+static  longword                mcTimeCount;
+static  INT16                   mcTickBuffer[2 * (44100 / 700)];
+static  int32_t                 alIdleSamples;
+
+//      Post chain variables
+//
+//      The final mix runs through a fixed chain of stages, each a separate
+//      pass over a block of 32-bit samples, so a disabled stage is skipped
+//      entirely. Filter coefficients are Q15 at 44100 Hz.
+#define DSPBLOCK        512             /* stereo frames per pass */
+#define DCPOLE          32604           /* 0.995, corner about 35 Hz */
+#define LOWPASSCOEF     22282           /* two poles at 8 kHz */
+#define REVERBFEEDBACK  22938           /* 0.7 */
+#define REVERBDAMP      9830            /* 0.3 */
+#define REVERBWET       9830            /* 0.3 */
+#define LIMITLEVEL      29000
+#define LIMITRELEASE    12              /* shift, about 90 ms */
+
+typedef struct
+{
+   int32_t *buf;
+   int      len;
+   int      pos;
+   int32_t  store;                      /* damping filter of a comb */
+} dspdelay_t;
+
+        int                     DSPStages;
+static  int32_t                 dspBlock[DSPBLOCK * 2];
+static  int32_t                 dcIn[2], dcOut[2];
+static  int32_t                 lpState[2][2];
+static  int32_t                 limitGain = 0x10000;
+static  int32_t                 combBuffer[1116 + 1277 + 1188 + 1356];
+static  int32_t                 allpassBuffer[556 + 579];
+static  dspdelay_t              combs[2][2] = {
+   {{combBuffer, 1116, 0, 0}, {combBuffer + 1116, 1277, 0, 0}},
+   {{combBuffer + 1116 + 1277, 1188, 0, 0}, {combBuffer + 1116 + 1277 + 1188, 1356, 0, 0}}
+};
+static  dspdelay_t              allpasses[2] = {
+   {allpassBuffer, 556, 0, 0}, {allpassBuffer + 556, 579, 0, 0}
+};
+
+//      Telemetry variables
+//
+//      A mixer callback starts with the music hook and ends with the post
+//      mix, so the time between them is the whole callback.
+static  audiostats_t            audioStats;
+static  longword                cbStart;
+static  int                     cbFrames;
+
+//      Trigger variables
+//
+//      A sound started between two mixer callbacks is placed as far into
+//      the next buffer as its event came after the last one, so onsets
+//      keep their spacing instead of snapping to buffer boundaries.
+//      Both sides are in real usec; the callback only publishes 32-bit
+//      values, which the game thread reads whole.
+static  volatile longword       mixStart;       /* last callback, usec */
+static  volatile int            mixFrames;
+static  longword                eventTime;      /* of the sounds being started */
 
 
 static void SD_SoundFinished(void)
@@ -133,23 +358,145 @@ void SD_StopDigitized(void)
       case SDS_PC:
          break;
       case SDS_SOUNDBLASTER:
+         Mix_LockAudio();
          Mix_HaltChannel(-1);
+         Mix_UnlockAudio();
          break;
    }
 }
 
+/*
+=============================================================================
+
+                                VOICE ALLOCATOR
+
+=============================================================================
+*/
+
+static boolean SD_VoiceBelow(int a, int b)
+{
+   if(Voices[a].weight != Voices[b].weight)
+      return Voices[a].weight < Voices[b].weight;
+   return Voices[a].serial < Voices[b].serial;
+}
+
+static void SD_VoiceSwap(int i, int j)
+{
+   int t = VoiceHeap[i];
+   VoiceHeap[i] = VoiceHeap[j];
+   VoiceHeap[j] = t;
+   VoiceHeapPos[VoiceHeap[i]] = i;
+   VoiceHeapPos[VoiceHeap[j]] = j;
+}
+
+static void SD_VoiceSift(int i)
+{
+   while(i > 0 && SD_VoiceBelow(VoiceHeap[i], VoiceHeap[(i - 1) / 2]))
+   {
+      SD_VoiceSwap(i, (i - 1) / 2);
+      i = (i - 1) / 2;
+   }
+
+   for(;;)
+   {
+      int low = i, child = i * 2 + 1;
+
+      if(child < VoiceHeapSize && SD_VoiceBelow(VoiceHeap[child], VoiceHeap[low]))
+         low = child;
+      if(child + 1 < VoiceHeapSize && SD_VoiceBelow(VoiceHeap[child + 1], VoiceHeap[low]))
+         low = child + 1;
+      if(low == i)
+         break;
+      SD_VoiceSwap(i, low);
+      i = low;
+   }
+}
+
+static void SD_ResetVoices(void)
+{
+   int i;
+
+   for(i = 0; i < MIX_CHANNELS; i++)
+      VoiceHeapPos[i] = -1;
+   for(i = 0; i < DIGIVOICES; i++)
+      FreeVoices[i] = MIX_CHANNELS - 1 - i;
+   NumFreeVoices = DIGIVOICES;
+   VoiceHeapSize = 0;
+}
+
+//
+//      Takes a channel off the heap, it stays in use until it's handed back
+//      or played again
+//
+static void SD_ReleaseVoice(int channel)
+{
+   int i = VoiceHeapPos[channel];
+
+   if(i < 0)
+      return;
+
+   VoiceHeapPos[channel] = -1;
+   if(i != --VoiceHeapSize)
+   {
+      VoiceHeap[i] = VoiceHeap[VoiceHeapSize];
+      VoiceHeapPos[VoiceHeap[i]] = i;
+      SD_VoiceSift(i);
+   }
+}
+
+static void SD_StartVoice(int channel, word priority, int distance)
+{
+   Voices[channel].weight = (int32_t) priority * DIGIDISTWEIGHT - distance;
+   Voices[channel].serial = VoiceSerial++;
+
+   VoiceHeap[VoiceHeapSize] = channel;
+   VoiceHeapPos[channel] = VoiceHeapSize;
+   SD_VoiceSift(VoiceHeapSize++);
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_AllocVoice() - finds a shared channel for a sound of the given
+//              priority and distance (0 near, 30 far), stealing the least
+//              important voice when all are busy. Returns -1 if every
+//              playing voice matters more than the new sound.
+//              SD_PickVoice() only looks.
+//
+///////////////////////////////////////////////////////////////////////////
+static int SD_PickVoice(word priority, int distance)
+{
+   int32_t weight = (int32_t) priority * DIGIDISTWEIGHT - distance;
+
+   if(NumFreeVoices)
+      return FreeVoices[NumFreeVoices - 1];
+   if(!VoiceHeapSize || weight < Voices[VoiceHeap[0]].weight)
+      return -1;
+   return VoiceHeap[0];
+}
+
+static int SD_AllocVoice(word priority, int distance)
+{
+   int channel = SD_PickVoice(priority, distance);
+
+   if(channel == -1)
+      return -1;
+
+   if(NumFreeVoices)
+      NumFreeVoices--;
+   else
+      SD_ReleaseVoice(channel);
+   return channel;
+}
+
 int SD_GetChannelForDigi(int which)
 {
    int channel;
+
    if(DigiChannel[which] != -1)
       return DigiChannel[which];
-
-   channel = Mix_GroupAvailable(1);
-   if(channel == -1)
-      channel = Mix_GroupOldest(1);
-
-   if(channel == -1)           /* All sounds stopped in the meantime? */
-      return Mix_GroupAvailable(1);
+   Mix_LockAudio();
+   channel = SD_PickVoice(DigiPriority, 0);
+   Mix_UnlockAudio();
    return channel;
 }
 
@@ -183,16 +530,26 @@ static int16_t GetSample(float csample, byte *samples, int size)
    return (int16_t) intval;
 }
 
+static void SD_Resample(byte *origsamples, int size, int16_t *newsamples, int destsamples)
+{
+   int i;
+
+   for(i=0; i<destsamples; i++)
+   {
+      newsamples[i] = GetSample((float)size * (float)i / (float)destsamples,
+            origsamples, size);
+   }
+}
+
+static boolean SD_EvictSound(int keep);
+
 void SD_PrepareSound(int which)
 {
-   unsigned i;
    int page, size;
    int destsamples;
    byte *origsamples;
    byte *wavebuffer;
    int16_t *newsamples;
-   float samplestep;
-   float cursample = 0.F;
 
    if(DigiList == NULL)
       Quit("SD_PrepareSound(%i): DigiList not initialized!\n", which);
@@ -200,13 +557,21 @@ void SD_PrepareSound(int which)
    page = DigiList[which].startpage;
    size = DigiList[which].length;
 
-   origsamples = PM_GetSound(page);
-   if(origsamples + size >= PM_GetEnd())
-      Quit("SD_PrepareSound(%i): Sound reaches out of page file!\n", which);
-
    destsamples = (int) ((float) size * (float)44100
          / (float) ORIGSAMPLERATE);
 
+   /* the mixer keeps a stereo copy next to the wave buffer */
+   while(MM_OverBudget(destsamples * 6))
+   {
+      if(!SD_EvictSound(which))
+      {
+         MM_BudgetMissed(destsamples * 6);
+         break;
+      }
+   }
+
+   origsamples = PM_GetSoundData(page, size);
+
    wavebuffer = (byte *)malloc(sizeof(headchunk) + sizeof(wavechunk)
          + destsamples * 2);     /* dest are 16-bit samples */
    if(wavebuffer == NULL)
@@ -225,17 +590,172 @@ void SD_PrepareSound(int which)
     * and sizeof(headchunk) % 4 == 0 and sizeof(wavechunk) % 4 == 0 */
    newsamples = (int16_t *)(void *) (wavebuffer + sizeof(headchunk)
          + sizeof(wavechunk));
-   samplestep = (float) ORIGSAMPLERATE / (float)44100;
-
-   for(i=0; i<destsamples; i++, cursample+=samplestep)
-   {
-      newsamples[i] = GetSample((float)size * (float)i / (float)destsamples,
-            origsamples, size);
-   }
+   SD_Resample(origsamples, size, newsamples, destsamples);
    SoundBuffers[which] = wavebuffer;
 
    SoundChunks[which] = Mix_LoadWAV_RW(SDL_RWFromMem(wavebuffer,
             sizeof(headchunk) + sizeof(wavechunk) + destsamples * 2), 1);
+
+   SoundBytes[which] = sizeof(headchunk) + sizeof(wavechunk) + destsamples * 2;
+   if(SoundChunks[which])
+      SoundBytes[which] += SoundChunks[which]->alen;
+
+   /* the chunk has its own copy, so under a budget drop the wave */
+   if(MMBudget && SoundChunks[which])
+   {
+      free(SoundBuffers[which]);
+      SoundBuffers[which] = NULL;
+      SoundBytes[which]   = SoundChunks[which]->alen;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_ResampleBench() - times the resampling SD_PrepareSound does, over
+//              every digitized sound, see CA_DecodeBench
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_ResampleBench(int runs)
+{
+   int i, run, size, destsamples, maxsamples = 0;
+   int32_t bytes = 0;
+   byte *origsamples;
+   int16_t *newsamples;
+   uint32_t start, usec = 0;
+   longword sum = CA_HASHSEED;
+
+   for(i = 0; i < NumDigi; i++)
+   {
+      destsamples = (int) ((float) DigiList[i].length * (float)44100
+            / (float) ORIGSAMPLERATE);
+      if(destsamples > maxsamples)
+         maxsamples = destsamples;
+   }
+
+   newsamples = (int16_t *) malloc(maxsamples * sizeof(int16_t));
+   CHECKMALLOCRESULT(newsamples);
+
+   for(i = 0; i < NumDigi; i++)
+   {
+      size = DigiList[i].length;
+      destsamples = (int) ((float) size * (float)44100 / (float) ORIGSAMPLERATE);
+
+      /* the page manager may hand out a shared buffer, keep a copy */
+      origsamples = (byte *) malloc(size);
+      CHECKMALLOCRESULT(origsamples);
+      memcpy(origsamples, PM_GetSoundData(DigiList[i].startpage, size), size);
+
+      for(run = 0; run < runs; run++)
+      {
+         start = LR_GetMicroTicks();
+         SD_Resample(origsamples, size, newsamples, destsamples);
+         usec += LR_GetMicroTicks() - start;
+      }
+      free(origsamples);
+
+      /* hashed little-endian, so all hosts print the same sum */
+      for(run = 0; run < destsamples; run++)
+         newsamples[run] = (int16_t)Retro_SwapLES16(newsamples[run]);
+      sum = CA_Hash(sum, newsamples, destsamples * 2);
+      bytes += destsamples * 2;
+   }
+
+   CA_BenchReport("resample", NumDigi, bytes, runs, usec, sum);
+   free(newsamples);
+}
+
+/*
+ * Frees the prepared sound that was played longest ago.
+ * Sounds of the current level are pinned.
+ */
+static boolean SD_EvictSound(int keep)
+{
+   int i, victim = -1;
+
+   for(i = 0; i < STARTMUSIC - STARTDIGISOUNDS; i++)
+   {
+      if(i == keep || !SoundBytes[i] || SoundLevel[i] == MMLevel)
+         continue;
+      if(victim == -1 || SoundLevel[i] < SoundLevel[victim])
+         victim = i;
+   }
+
+   if(victim == -1)
+      return false;
+
+   if(SoundChunks[victim])
+      Mix_FreeChunk(SoundChunks[victim]);     /* also stops it */
+   free(SoundBuffers[victim]);
+   SoundChunks[victim]  = NULL;
+   SoundBuffers[victim] = NULL;
+   SoundBytes[victim]   = 0;
+   return true;
+}
+
+int32_t SD_ResidentBytes(void)
+{
+   int i;
+   int32_t bytes = 0;
+
+   for(i = 0; i < STARTMUSIC - STARTDIGISOUNDS; i++)
+      bytes += SoundBytes[i];
+   for(i = 0; i < MUSICCACHESONGS; i++)
+   {
+      if(MusicCache[i].chunk)
+         bytes += MusicCache[i].length * 2 + MusicCache[i].imflen;
+   }
+   return bytes;
+}
+
+/* Counts the digitized sounds played since the level started */
+void SD_LevelWorkingSet(int *sounds, int32_t *bytes)
+{
+   int i;
+
+   *sounds = 0;
+   *bytes  = 0;
+
+   for(i = 0; i < STARTMUSIC - STARTDIGISOUNDS; i++)
+   {
+      if(SoundLevel[i] != MMLevel)
+         continue;
+      (*sounds)++;
+      *bytes += SoundBytes[i];
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_SetEventTime() - stamps the sounds started from now on with a game
+//              time, tic plus subtic/65536, on the GetTimeCount() clock.
+//              The stamp is kept in real time, where the mixer runs: at a
+//              clock rate of 200 game time passes twice as fast.
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_SetEventTime(int32_t tic, word subtic)
+{
+   int64_t ahead = (int64_t) tic * 100000 / 7
+         + (int64_t) subtic * 100000 / (7 * 65536)
+         - (int64_t) LR_GetTicks() * 1000;
+
+   eventTime = LR_GetMicroTicks() + (longword) (ahead * 100 / (int) LR_GetClockRate());
+}
+
+//
+//      Frames into the next mix at which a sound stamped with eventTime
+//      belongs. Stale stamps, from menus or before the last callback,
+//      start right away.
+//
+static int SD_EventOffset(void)
+{
+   int32_t usec = (int32_t) (eventTime - mixStart);
+   int frames;
+
+   if(!mixFrames || usec <= 0)
+      return 0;
+
+   frames = (int) ((int64_t) usec * 44100 / 1000000);
+   return frames < mixFrames ? frames : mixFrames - 1;
 }
 
 int SD_PlayDigitized(word which,int leftpos,int rightpos)
@@ -246,20 +766,46 @@ int SD_PlayDigitized(word which,int leftpos,int rightpos)
    if (which >= NumDigi)
       Quit("SD_PlayDigitized: bad sound number %i", which);
 
-   int channel = SD_GetChannelForDigi(which);
+   int channel = DigiChannel[which];
+   boolean voice = channel == -1;
+
+   if(voice)
+   {
+      Mix_LockAudio();
+      channel = SD_AllocVoice(DigiPriority, leftpos + rightpos);
+      Mix_UnlockAudio();
+      if(channel == -1)
+         return -1;     /* everything playing matters more */
+   }
    SD_SetPosition(channel, leftpos,rightpos);
 
    DigiPlaying = true;
 
+   /* under a budget sounds are prepared on first use */
+   SoundLevel[which] = MMLevel;
+   if(!SoundChunks[which] && MMBudget)
+      SD_PrepareSound(which);
+
+   /* a stolen voice is off the heap until it starts again, so the callback
+      leaves it alone while the sound is prepared */
    Mix_Chunk *sample = SoundChunks[which];
-   if(sample == NULL)
+   Mix_LockAudio();
+   if(sample == NULL || Mix_PlayChannel(channel, sample, 0) == -1)
    {
-      printf("SoundChunks[%i] is NULL!\n", which);
-      return 0;
+      if(voice)
+         FreeVoices[NumFreeVoices++] = channel;
+      Mix_UnlockAudio();
+      if(sample == NULL)
+         printf("SoundChunks[%i] is NULL!\n", which);
+      return -1; /* Unable to play sound */
    }
 
-   if(Mix_PlayChannel(channel, sample, 0) == -1)
-      return 0; /* Unable to play sound */
+   if(voice)
+      SD_StartVoice(channel, DigiPriority, leftpos + rightpos);
+
+   /* the callback must not mix the chunk before its delay is set */
+   Mix_DelayChannel(channel, SD_EventOffset());
+   Mix_UnlockAudio();
 
    return channel;
 }
@@ -267,6 +813,12 @@ int SD_PlayDigitized(word which,int leftpos,int rightpos)
 void SD_ChannelFinished(int channel)
 {
    channelSoundPos[channel].valid = 0;
+
+   if(VoiceHeapPos[channel] >= 0)
+   {
+      SD_ReleaseVoice(channel);
+      FreeVoices[NumFreeVoices++] = channel;
+   }
 }
 
 void SD_SetDigiDevice(SDSMode mode)
@@ -358,6 +910,83 @@ static void SD_SetupDigi(void)
    }
 }
 
+/*      PC Sound Code */
+
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_PCPlaySound() - Plays the specified sound on the PC speaker
+//
+///////////////////////////////////////////////////////////////////////////
+static void SD_PCPlaySound(PCSound *sound)
+{
+   pcSound      = NULL;
+   pcLengthLeft = sound->common.length;
+   /* the chunk is cached as is, so the data follows the original header */
+   pcSound      = (byte *) sound + ORIG_SOUNDCOMMON_SIZE;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_PCStopSound() - Stops the current sound playing on the PC speaker
+//
+///////////////////////////////////////////////////////////////////////////
+static void SD_PCStopSound(void)
+{
+   pcSound     = NULL;
+   pcPhaseStep = 0;
+}
+
+static float SD_PolyBLEP(float t, float dt)
+{
+   if(t < dt)
+   {
+      t /= dt;
+      return t + t - t * t - 1.F;
+   }
+   if(t > 1.F - dt)
+   {
+      t = (t - 1.F) / dt;
+      return t * t + t + t + 1.F;
+   }
+   return 0.F;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_PCMix() - Adds the speaker's square wave to the mixer buffer,
+//              with polyBLEP steps so high tones do not alias
+//
+///////////////////////////////////////////////////////////////////////////
+static void SD_PCMix(INT16 *stream16, int samples)
+{
+   int i, s;
+   float t, v;
+   float dt = pcPhaseStep;
+
+   if(!dt)
+      return;
+
+   for(i = 0; i < samples; i++)
+   {
+      t = pcPhase + 0.5F;
+      if(t >= 1.F)
+         t -= 1.F;
+      v = (pcPhase < 0.5F ? 1.F : -1.F)
+         + SD_PolyBLEP(pcPhase, dt) - SD_PolyBLEP(t, dt);
+
+      s = stream16[i*2] + (int) (v * PCVOLUME);
+      if(s > 32767)
+         s = 32767;
+      else if(s < -32768)
+         s = -32768;
+      stream16[i*2] = stream16[i*2+1] = s;
+
+      pcPhase += dt;
+      if(pcPhase >= 1.F)
+         pcPhase -= 1.F;
+   }
+}
+
 /*      AdLib Code */
 
 ///////////////////////////////////////////////////////////////////////////
@@ -481,9 +1110,7 @@ static void SD_ShutDevice(void)
    switch (SoundMode)
    {
       case SDM_PC:
-#if 0
-         SD_ShutPC();
-#endif
+         SD_PCStopSound();
          break;
       case SDM_ADLIB:
          SD_ShutAL();
@@ -571,15 +1198,17 @@ boolean SD_SetSoundMode(SDMode mode)
 ///////////////////////////////////////////////////////////////////////////
 //
 //      SD_SetMusicMode() - sets the device to use for background music
+//              Any fade still running is cut short
 //
 ///////////////////////////////////////////////////////////////////////////
+static void SD_CutFades(void);
+
 boolean SD_SetMusicMode(SMMode mode)
 {
    boolean result = false;
 
    SD_FadeOutMusic();
-   while (SD_MusicPlaying())
-      rarch_sleep(5);
+   SD_CutFades();
 
    switch (mode)
    {
@@ -605,36 +1234,763 @@ longword curAlLengthLeft = 0;
 int soundTimeCounter = 5;
 int samplesPerMusicTick;
 
-static void SD_IMFMusicPlayer(void *udata, Uint8 *stream, int len)
+/*
+=============================================================================
+
+                                MUSIC CACHE
+
+=============================================================================
+*/
+
+/* Counts the ticks the sequencer needs for one pass over a song */
+static longword SD_MusicTicks(word *imf, int len)
 {
-   int stereolen = len>>1;
-   int sampleslen = stereolen>>1;
-   INT16 *stream16 = (INT16 *) (void *) stream;    /* expect correct alignment */
+   longword time = 0, count = 0;
 
-   while(1)
+   do
    {
-      if(numreadysamples)
+      do
       {
-         if(numreadysamples < sampleslen)
-         {
-            YM3812UpdateOne(0, stream16, numreadysamples);
-            stream16 += numreadysamples*2;
-            sampleslen -= numreadysamples;
-         }
-         else
-         {
-            YM3812UpdateOne(0, stream16, sampleslen);
-            numreadysamples -= sampleslen;
-            return;
-         }
+         if(time > count) break;
+         time = count + (word)Retro_SwapLES16(*(imf+1));
+         imf += 2;
+         len -= 4;
       }
-      soundTimeCounter--;
-      if(!soundTimeCounter)
-      {
-         soundTimeCounter = 5;
-         if(curAlSound != alSound)
-         {
-            curAlSound = curAlSoundPtr = alSound;
+      while(len > 0);
+      count++;
+   }
+   while(len > 0);
+
+   return count;
+}
+
+static void SD_MusicCachePath(char *path, size_t size, int chunk)
+{
+   snprintf(path, size, "%smusic%02d.%s", configdir, chunk - STARTMUSIC, audioext);
+}
+
+static boolean SD_LoadMusicCache(musiccache_t *mc)
+{
+   char path[300];
+   longword head[MUSICCACHEHEAD];
+   int handle;
+   boolean ok;
+
+   SD_MusicCachePath(path, sizeof(path), mc->chunk);
+   handle = open(path, O_RDONLY | O_BINARY);
+   if(handle == -1)
+      return false;
+
+   ok = read(handle, head, sizeof(head)) == sizeof(head)
+      && (longword) Retro_SwapLES32(head[0]) == MUSICCACHEMAGIC
+      && (longword) Retro_SwapLES32(head[1]) == mc->file[1]
+      && (longword) Retro_SwapLES32(head[2]) == (longword) mc->length
+      && read(handle, mc->pcm, mc->length * 2) == mc->length * 2;
+   close(handle);
+
+   if(ok)
+   {
+      int32_t i;
+      for(i = 0; i < mc->length; i++)
+         mc->pcm[i] = Retro_SwapLES16(mc->pcm[i]);
+   }
+   return ok;
+}
+
+static void SD_SaveMusicCache(void)
+{
+   int i;
+   int32_t j;
+   char path[300];
+   musiccache_t *mc;
+   longword *file;
+   INT16 *pcm;
+
+   if(MusicCacheMode != MCM_DISK)
+      return;
+
+   for(i = 0; i < MUSICCACHESONGS; i++)
+   {
+      mc = &MusicCache[i];
+      if(!mc->chunk || mc->saved || mc->rendered < mc->length)
+         continue;
+
+      /* the song may be streaming, so swap into a copy */
+      file = (longword *) malloc(sizeof(longword) * MUSICCACHEHEAD + mc->length * 2);
+      CHECKMALLOCRESULT(file);
+      for(j = 0; j < MUSICCACHEHEAD; j++)
+         file[j] = Retro_SwapLES32(mc->file[j]);
+      pcm = (INT16 *) (file + MUSICCACHEHEAD);
+      for(j = 0; j < mc->length; j++)
+         pcm[j] = Retro_SwapLES16(mc->pcm[j]);
+
+      SD_MusicCachePath(path, sizeof(path), mc->chunk);
+      CA_WriteFile(path, file, sizeof(longword) * MUSICCACHEHEAD + mc->length * 2);
+      free(file);
+      mc->saved = true;
+   }
+}
+
+static void SD_FreeMusicCache(musiccache_t *mc)
+{
+   if(mcFading == mc)
+      mcFading = NULL;
+   if(mcRender == mc)
+      mcRender = NULL;
+   if(mcCurrent == mc)
+      mcCurrent = NULL;
+   free(mc->imf);
+   free(mc->file);
+   memset(mc, 0, sizeof(*mc));
+}
+
+/*
+======================
+=
+= SD_CacheMusic
+=
+= Returns the cache entry for a song, starting a render if the song is not
+= cached yet. Returns NULL if the song has to be synthesized live.
+=
+======================
+*/
+
+static musiccache_t *SD_CacheMusic(int chunk)
+{
+   int i;
+   longword ticks;
+   musiccache_t *mc = NULL;
+
+   if(MusicCacheMode == MCM_OFF || sqHackSeqLen <= 0 || sqHackSeqLen & 3)
+      return NULL;
+
+   SD_SaveMusicCache();
+
+   for(i = 0; i < MUSICCACHESONGS; i++)
+   {
+      if(MusicCache[i].chunk == chunk)
+      {
+         mc = &MusicCache[i];
+         mc->lastuse = ++mcUseCount;
+         if(mc->rendered < mc->length && mcRender != mc)
+            break;                      /* abandoned half way, start over */
+         return mc;
+      }
+   }
+
+   /* only one song renders at a time */
+   Mix_LockAudio();
+   if(mcRender)
+      SD_FreeMusicCache(mcRender);
+
+   if(!mc)
+   {
+      for(i = 0; i < MUSICCACHESONGS; i++)
+      {
+         if(!MusicCache[i].chunk)
+         {
+            mc = &MusicCache[i];
+            break;
+         }
+         if(!mc || MusicCache[i].lastuse < mc->lastuse)
+            mc = &MusicCache[i];
+      }
+   }
+   if(mc->chunk)
+      SD_FreeMusicCache(mc);
+   Mix_UnlockAudio();
+
+   ticks = SD_MusicTicks(sqHack, sqHackSeqLen);
+   if(MM_OverBudget(ticks * samplesPerMusicTick * 2 + sqHackSeqLen))
+      return NULL;
+
+   mc->chunk   = chunk;
+   mc->imflen  = sqHackSeqLen;
+   mc->imf     = (word *) malloc(mc->imflen);
+   CHECKMALLOCRESULT(mc->imf);
+   memcpy(mc->imf, sqHack, mc->imflen);
+   mc->length  = ticks * samplesPerMusicTick;
+   mc->file    = (longword *) malloc(sizeof(longword) * MUSICCACHEHEAD + mc->length * 2);
+   CHECKMALLOCRESULT(mc->file);
+   mc->file[0] = MUSICCACHEMAGIC;
+   mc->file[1] = CA_Hash(CA_HASHSEED, mc->imf, mc->imflen);
+   mc->file[2] = mc->length;
+   mc->pcm     = (INT16 *) (mc->file + MUSICCACHEHEAD);
+   mc->lastuse = ++mcUseCount;
+
+   if(MusicCacheMode == MCM_DISK && SD_LoadMusicCache(mc))
+   {
+      mc->rendered = mc->length;
+      mc->saved    = true;
+   }
+   else
+   {
+      Mix_LockAudio();
+      mcRender = mc;
+      Mix_UnlockAudio();
+   }
+
+   return mc;
+}
+
+/*
+======================
+=
+= SD_RenderMusicCache
+=
+= Runs the sequencer for mcRender on OPL 1, the same way SD_IMFMusicPlayer
+= runs it on OPL 0, for up to the given number of samples or until
+= LR_GetMicroTicks reaches deadline, whichever comes first
+=
+======================
+*/
+
+static void SD_RenderMusicCache(int samples, longword deadline)
+{
+   int i;
+   musiccache_t *mc = mcRender;
+
+   if(!mc)
+      return;
+
+   if(mc != mcCurrent)
+   {
+      YM3812ResetChip(1);
+      for(i = 1; i < 0xf6; i++)
+         YM3812Write(1, i, 0);
+      YM3812Write(1, 1, 0x20);          /* Set WSE=1 */
+
+      mcPtr       = mc->imf;
+      mcLen       = mc->imflen;
+      mcTime      = 0;
+      mcTimeCount = 0;
+      mcCurrent   = mc;
+   }
+
+   while(samples > 0 && mc->rendered < mc->length
+      && (int32_t) (deadline - LR_GetMicroTicks()) > 0)
+   {
+      do
+      {
+         if(mcTime > mcTimeCount) break;
+         mcTime = mcTimeCount + (word)Retro_SwapLES16(*(mcPtr+1));
+         YM3812Write(1, *(byte *) mcPtr, *(((byte *) mcPtr)+1));
+         mcPtr += 2;
+         mcLen -= 4;
+      }
+      while(mcLen > 0);
+      mcTimeCount++;
+
+      YM3812UpdateOne(1, mcTickBuffer, samplesPerMusicTick);
+      for(i = 0; i < samplesPerMusicTick; i++)
+         mc->pcm[mc->rendered + i] = mcTickBuffer[i*2];
+      mc->rendered += samplesPerMusicTick;
+      samples -= samplesPerMusicTick;
+   }
+
+   if(mc->rendered == mc->length)
+      mcRender = NULL;
+}
+
+/*
+======================
+=
+= SD_UpdateOPL
+=
+= Renders OPL 0 and mixes in the cached music. Once nothing has played on
+= OPL 0 for a second, released notes have died away and the chip is skipped.
+=
+======================
+*/
+
+/* Adds a streamed song at a gain ramping by step per sample, returns the new position */
+static int32_t SD_MixMusic(INT16 *stream16, int samples, musiccache_t *mc,
+                           int32_t pos, int32_t *gain, int32_t step)
+{
+   int i, s;
+   int32_t g = *gain;
+
+   for(i = 0; i < samples; i++)
+   {
+      s = stream16[i*2] + ((mc->pcm[pos] * g) >> 16);
+      if(s > 32767)
+         s = 32767;
+      else if(s < -32768)
+         s = -32768;
+      stream16[i*2] = stream16[i*2+1] = s;
+      if(++pos == mc->length)
+         pos = 0;
+
+      if(step)
+      {
+         g += step;
+         if(g <= 0 || g >= MUSICUNITY)
+         {
+            g = g <= 0 ? 0 : MUSICUNITY;
+            step = 0;
+         }
+      }
+   }
+
+   *gain = g;
+   return pos;
+}
+
+static void SD_UpdateOPL(INT16 *stream16, int samples)
+{
+   musiccache_t *mc = mcPlaying;
+   musiccache_t *fade = mcFading;
+
+   if(curAlSound || sqFading || (sqActive && !mcStreaming))
+      alIdleSamples = 0;
+   else if(alIdleSamples < 44100)
+      alIdleSamples += samples;
+
+   if(alIdleSamples < 44100)
+      YM3812UpdateOne(0, stream16, samples);
+   else
+      memset(stream16, 0, samples * 4);
+
+   if(fade)
+   {
+      mcFadePos = SD_MixMusic(stream16, samples, fade, mcFadePos, &mcFadeGain,
+            -MUSICUNITY / MUSICFADESAMPLES);
+      if(!mcFadeGain)
+         mcFading = NULL;
+   }
+
+   if(sqActive && mcStreaming && mc)
+   {
+      mcPos = SD_MixMusic(stream16, samples, mc, mcPos, &mcGain, mcGainStep);
+      if(mcGain == MUSICUNITY)
+         mcGainStep = 0;
+   }
+}
+
+/*
+=============================================================================
+
+                                POST CHAIN
+
+=============================================================================
+*/
+
+static void SD_DCBlock(int32_t *buf, int frames)
+{
+   int i, c;
+   int32_t x;
+
+   for(c = 0; c < 2; c++)
+   {
+      for(i = c; i < frames * 2; i += 2)
+      {
+         x = buf[i];
+         dcOut[c] = x - dcIn[c] + (int32_t) ((DCPOLE * (int64_t) dcOut[c]) >> 15);
+         dcIn[c] = x;
+         buf[i] = dcOut[c];
+      }
+   }
+}
+
+static void SD_LowPass(int32_t *buf, int frames)
+{
+   int i, c;
+   int32_t *s;
+
+   for(c = 0; c < 2; c++)
+   {
+      s = lpState[c];
+      for(i = c; i < frames * 2; i += 2)
+      {
+         /* the DC stage swings past 16 bits, so the products need 64 */
+         s[0] += (int32_t) ((LOWPASSCOEF * (int64_t) (buf[i] - s[0])) >> 15);
+         s[1] += (int32_t) ((LOWPASSCOEF * (int64_t) (s[0] - s[1])) >> 15);
+         buf[i] = s[1];
+      }
+   }
+}
+
+/* Two damped combs and an allpass per side, after Schroeder/Freeverb */
+static void SD_Reverb(int32_t *buf, int frames)
+{
+   int i, c, j;
+   int32_t in, out, y;
+   dspdelay_t *d;
+
+   for(c = 0; c < 2; c++)
+   {
+      for(i = c; i < frames * 2; i += 2)
+      {
+         in  = buf[i] >> 2;
+         out = 0;
+         for(j = 0; j < 2; j++)
+         {
+            d = &combs[c][j];
+            y = d->buf[d->pos];
+            d->store = y + (int32_t) ((REVERBDAMP * (int64_t) (d->store - y)) >> 15);
+            d->buf[d->pos] = in + (int32_t) ((REVERBFEEDBACK * (int64_t) d->store) >> 15);
+            if(++d->pos == d->len)
+               d->pos = 0;
+            out += y;
+         }
+
+         d = &allpasses[c];
+         y = d->buf[d->pos];
+         d->buf[d->pos] = out + (y >> 1);
+         if(++d->pos == d->len)
+            d->pos = 0;
+         out = y - out;
+
+         buf[i] += (int32_t) ((REVERBWET * (int64_t) out) >> 15);
+      }
+   }
+}
+
+/* Instant attack, slow release, on the louder side of each frame */
+static void SD_Limiter(int32_t *buf, int frames)
+{
+   int i;
+   int32_t peak, r;
+
+   for(i = 0; i < frames * 2; i += 2)
+   {
+      peak = abs(buf[i]);
+      r = abs(buf[i+1]);
+      if(r > peak)
+         peak = r;
+
+      if((int64_t) peak * limitGain > (int64_t) LIMITLEVEL << 16)
+         limitGain = (int32_t) (((int64_t) LIMITLEVEL << 16) / peak);
+      else
+         limitGain += (0x10000 - limitGain) >> LIMITRELEASE;
+
+      buf[i]   = (int32_t) (((int64_t) buf[i] * limitGain) >> 16);
+      buf[i+1] = (int32_t) (((int64_t) buf[i+1] * limitGain) >> 16);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_PostMix() - runs the enabled post chain stages in place on the
+//              final mix
+//
+///////////////////////////////////////////////////////////////////////////
+static void SD_AccountCallback(void);
+
+static void SD_PostMix(void *udata, Uint8 *stream, int len)
+{
+   int i, frames;
+   int stages = DSPStages;
+   INT16 *stream16 = (INT16 *) (void *) stream;    /* expect correct alignment */
+
+   for(frames = stages ? len >> 2 : 0; frames > 0; frames -= DSPBLOCK, stream16 += DSPBLOCK * 2)
+   {
+      int n = frames < DSPBLOCK ? frames : DSPBLOCK;
+
+      for(i = 0; i < n * 2; i++)
+         dspBlock[i] = stream16[i];
+
+      if(stages & DSP_DCBLOCK)
+         SD_DCBlock(dspBlock, n);
+      if(stages & DSP_LOWPASS)
+         SD_LowPass(dspBlock, n);
+      if(stages & DSP_REVERB)
+         SD_Reverb(dspBlock, n);
+      if(stages & DSP_LIMITER)
+         SD_Limiter(dspBlock, n);
+
+      for(i = 0; i < n * 2; i++)
+      {
+         if(dspBlock[i] > 32767)
+            stream16[i] = 32767;
+         else if(dspBlock[i] < -32768)
+            stream16[i] = -32768;
+         else
+            stream16[i] = (INT16) dspBlock[i];
+      }
+   }
+
+   /* whatever is left of the render budget goes to the music cache */
+   if(mcRender && cbFrames)
+      SD_RenderMusicCache(cbFrames * MUSICCACHESPEED, LR_GetMicroTicks()
+            + (longword) cbFrames * (1000000 / 100 * MUSICCACHELOAD) / 44100);
+
+   SD_AccountCallback();
+}
+
+/*
+=============================================================================
+
+                                TELEMETRY
+
+=============================================================================
+*/
+
+static void SD_AccountCallback(void)
+{
+   longword usec, period;
+   int load, bucket;
+
+   if(!cbFrames)
+      return;
+
+   usec   = LR_GetMicroTicks() - cbStart;
+   period = (longword) cbFrames * 1000000 / 44100;
+   load   = (int) (usec * 100 / period);
+   cbFrames = 0;
+
+   audioStats.callbacks++;
+   audioStats.periodusec = period;
+   audioStats.lastusec   = usec;
+   audioStats.load       = load;
+   if(usec > audioStats.maxusec)
+      audioStats.maxusec = usec;
+   if(load > audioStats.peakload)
+      audioStats.peakload = load;
+
+   if(usec >= period)
+      audioStats.underruns++;
+   else if(usec * 4 >= period * 3)
+      audioStats.nearmisses++;
+
+   bucket = load / 10;
+   if(bucket >= AUDIOHISTBUCKETS)
+      bucket = AUDIOHISTBUCKETS - 1;
+   audioStats.histogram[bucket]++;
+
+   audioStats.channels   = Mix_Playing(-1);
+   audioStats.oplchips   = (alIdleSamples < 44100) + (mcRender != NULL);
+   audioStats.samplerate = 44100;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_GetAudioStats() - copies the mixer callback timing gathered since
+//              startup or the last SD_ResetAudioStats()
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_GetAudioStats(audiostats_t *stats)
+{
+   *stats = audioStats;
+}
+
+void SD_ResetAudioStats(void)
+{
+   memset(&audioStats, 0, sizeof(audioStats));
+}
+
+void SD_ReportAudioStats(void)
+{
+   int i;
+
+   printf("Audio: %u callbacks of %u us, last %u us, max %u us (%d%%)\n",
+         audioStats.callbacks, audioStats.periodusec, audioStats.lastusec,
+         audioStats.maxusec, audioStats.peakload);
+   printf("Audio: %u underruns, %u near misses\n",
+         audioStats.underruns, audioStats.nearmisses);
+   if(audioStats.helddropped)
+      printf("Audio: %u speculative calls dropped\n", audioStats.helddropped);
+   for(i = 0; i < AUDIOHISTBUCKETS; i++)
+   {
+      if(i < AUDIOHISTBUCKETS - 1)
+         printf("Audio: %3d-%3d%% %u\n", i * 10, i * 10 + 10, audioStats.histogram[i]);
+      else
+         printf("Audio:  >100%% %u\n", audioStats.histogram[i]);
+   }
+}
+
+/* Switches a live song over to its cache once the render has caught up */
+static void SD_StreamMusic(void)
+{
+   int i;
+   musiccache_t *mc = mcPlaying;
+
+   if(mcStreaming || !mc || mc->rendered < mc->length)
+      return;
+
+   mcPos = sqTicks * samplesPerMusicTick;
+   if(mcFading)
+   {
+      /* crossfade with the song that was turned off */
+      mcGain     = 0;
+      mcGainStep = MUSICUNITY / MUSICFADESAMPLES;
+   }
+   else
+   {
+      mcGain     = MUSICUNITY;
+      mcGainStep = 0;
+   }
+   mcStreaming = true;
+
+   YM3812Write(0, alEffects, 0);
+   for(i = 0; i < sqMaxTracks; i++)
+      YM3812Write(0, alFreqH + i + 1, 0);
+}
+
+/* Total level of an operator as written by the music, attenuated by a fade */
+static byte SD_FadedLevel(int op, int level)
+{
+   int  ch  = op % 8 % 3 + op / 8 * 3;
+   byte val = sqRegs[alScale + op];
+   int  tl;
+
+   /* a modulator in FM mode shapes the tone, not the volume */
+   if(!level || (op % 8 < 3 && !(sqRegs[alFeedCon + ch] & 1)))
+      return val;
+
+   tl = (val & 0x3f) + level / LIVEFADETICKS;
+   return (val & 0xc0) | (tl > 0x3f ? 0x3f : tl);
+}
+
+/* Rewrites the total levels of the music channels for a new fade level */
+static void SD_FadeChannels(int level)
+{
+   int ch, op;
+
+   for(ch = 1; ch < 9; ch++)
+   {
+      op = ch % 3 + ch / 3 * 8;
+      YM3812Write(0, alScale + op, SD_FadedLevel(op, level));
+      YM3812Write(0, alScale + op + 3, SD_FadedLevel(op + 3, level));
+   }
+}
+
+/* Writes a register for the music, at the given fade level */
+static void SD_MusicWrite(byte reg, byte val, int level)
+{
+   sqRegs[reg] = val;
+   if(level && reg >= alScale && reg < alScale + 0x16)
+      val = SD_FadedLevel(reg - alScale, level);
+   YM3812Write(0, reg, val);
+   if(level && reg > alFeedCon && reg < alFeedCon + 9)
+      SD_FadeChannels(level);
+}
+
+/* Puts the registers SD_SeekMusic worked out on the chip */
+static void SD_ApplySeek(void)
+{
+   int i, reg;
+
+   SD_MusicWrite(alEffects, 0, sqInLevel);
+   for(i = 0; i < sqMaxTracks; i++)
+      SD_MusicWrite(alFreqH + i + 1, 0, sqInLevel);
+
+   for(reg = 0; reg < 256; reg++)
+   {
+      if(sqSeekUsed[reg >> 3] & (1 << (reg & 7)))
+         SD_MusicWrite(reg, sqSeekRegs[reg], sqInLevel);
+   }
+   sqSeekPending = false;
+}
+
+/* Plays one tick of the song that fades out, keys it off once silent */
+static void SD_FadeTick(void)
+{
+   int i;
+
+   do
+   {
+      if(sqFadeTime > sqFadeTimeCount) break;
+      sqFadeTime = sqFadeTimeCount + (word)Retro_SwapLES16(*(sqFadePtr+1));
+      SD_MusicWrite(*(byte *) sqFadePtr, *(((byte *) sqFadePtr)+1), sqFadeLevel);
+      sqFadePtr += 2;
+      sqFadeLen -= 4;
+   }
+   while(sqFadeLen>0);
+   sqFadeTimeCount++;
+   if(!sqFadeLen)
+   {
+      sqFadePtr = sqFadeHack;
+      sqFadeLen = sqFadeSeqLen;
+      sqFadeTime = 0;
+      sqFadeTimeCount = 0;
+   }
+
+   if(++sqFadeLevel % LIVEFADETICKS == 0)
+      SD_FadeChannels(sqFadeLevel);
+
+   if(sqFadeLevel >= LIVEFADESTEPS * LIVEFADETICKS)
+   {
+      SD_MusicWrite(alEffects, 0, sqFadeLevel);
+      for(i = 0; i < sqMaxTracks; i++)
+         SD_MusicWrite(alFreqH + i + 1, 0, sqFadeLevel);
+      sqInLevel = sqFadeLevel;
+      sqFading = false;
+   }
+}
+
+/* Ends both kinds of fade at once, without waiting on the mixer callback */
+static void SD_CutFades(void)
+{
+   int i;
+
+   Mix_LockAudio();
+   if(sqFading)
+   {
+      YM3812Write(0, alEffects, 0);
+      for(i = 0; i < sqMaxTracks; i++)
+         YM3812Write(0, alFreqH + i + 1, 0);
+      sqInLevel = LIVEFADESTEPS * LIVEFADETICKS;
+      sqFading  = false;
+   }
+   mcFading   = NULL;
+   mcFadeGain = 0;
+   Mix_UnlockAudio();
+}
+
+static void SD_IMFMusicPlayer(void *udata, Uint8 *stream, int len)
+{
+   int stereolen = len>>1;
+   int sampleslen = stereolen>>1;
+   INT16 *stream16 = (INT16 *) (void *) stream;    /* expect correct alignment */
+
+   cbStart  = LR_GetMicroTicks();
+   cbFrames = sampleslen;
+   mixStart  = cbStart;
+   mixFrames = sampleslen;
+
+   while(1)
+   {
+      if(numreadysamples)
+      {
+         if(numreadysamples < sampleslen)
+         {
+            SD_UpdateOPL(stream16, numreadysamples);
+            SD_PCMix(stream16, numreadysamples);
+            stream16 += numreadysamples*2;
+            sampleslen -= numreadysamples;
+         }
+         else
+         {
+            SD_UpdateOPL(stream16, sampleslen);
+            SD_PCMix(stream16, sampleslen);
+            numreadysamples -= sampleslen;
+            return;
+         }
+      }
+      soundTimeCounter--;
+      if(!soundTimeCounter)
+      {
+         soundTimeCounter = 5;
+         if(pcSound)
+         {
+            if(*pcSound)
+               pcPhaseStep = (float) PCTIMERCLOCK / (*pcSound * 60) / 44100;
+            else
+               pcPhaseStep = 0;
+            pcSound++;
+            pcLengthLeft--;
+            if(!pcLengthLeft)
+            {
+               pcSound = 0;
+               pcPhaseStep = 0;
+               SoundNumber = (soundnames) 0;
+               SoundPriority = 0;
+            }
+         }
+         if(curAlSound != alSound)
+         {
+            curAlSound = curAlSoundPtr = alSound;
             curAlLengthLeft = alLengthLeft;
          }
          if(curAlSound)
@@ -656,24 +2012,36 @@ static void SD_IMFMusicPlayer(void *udata, Uint8 *stream, int len)
             }
          }
       }
-      if(sqActive)
+      if(sqFading)
+         SD_FadeTick();
+      else if(sqActive)
       {
+         if(sqSeekPending)
+            SD_ApplySeek();
+         SD_StreamMusic();
+
+         /* keep stepping a streamed song, for SD_MusicOff's offset */
          do
          {
             if(sqHackTime > alTimeCount) break;
             sqHackTime = alTimeCount + (word)Retro_SwapLES16(*(sqHackPtr+1));
-            YM3812Write(0, *(byte *) sqHackPtr, *(((byte *) sqHackPtr)+1));
+            if(!mcStreaming)
+               SD_MusicWrite(*(byte *) sqHackPtr, *(((byte *) sqHackPtr)+1), sqInLevel);
             sqHackPtr += 2;
             sqHackLen -= 4;
          }
          while(sqHackLen>0);
+         if(sqInLevel && --sqInLevel % LIVEFADETICKS == 0)
+            SD_FadeChannels(sqInLevel);
          alTimeCount++;
+         sqTicks++;
          if(!sqHackLen)
          {
             sqHackPtr = sqHack;
             sqHackLen = sqHackSeqLen;
             sqHackTime = 0;
             alTimeCount = 0;
+            sqTicks = 0;
          }
       }
       numreadysamples = samplesPerMusicTick;
@@ -696,14 +2064,14 @@ void SD_Startup(void)
    if(Mix_OpenAudio(44100, AUDIO_S16, 2, 2048))
       return; /* Unable to open audio */
 
-   Mix_ReserveChannels(2);  /* reserve player and boss weapon channels */
-   Mix_GroupChannels(2, MIX_CHANNELS-1, 1); /* group remaining channels */
+   Mix_ReserveChannels(DIGIFIRSTVOICE);  /* reserve player and boss weapon channels */
+   SD_ResetVoices();                     /* the remaining channels are voices */
 
    /* Initialize music */
 
    samplesPerMusicTick = 44100 / 700; /*played at 700Hzs */
 
-   if(YM3812Init(1, 3579545, 44100))
+   if(YM3812Init(2, 3579545, 44100))    /* the second OPL renders the music cache */
       printf("Unable to create virtual OPL!!\n");
 
    for(i=1;i<0xf6;i++)
@@ -712,6 +2080,7 @@ void SD_Startup(void)
    YM3812Write(0,1,0x20); /* Set WSE=1 */
 
    Mix_HookMusic(SD_IMFMusicPlayer, 0);
+   Mix_SetPostMix(SD_PostMix, 0);
    Mix_ChannelFinished(SD_ChannelFinished);
    AdLibPresent = true;
    SoundBlasterPresent = true;
@@ -751,6 +2120,20 @@ void SD_Shutdown(void)
 
    free(DigiList);
 
+   SD_SaveMusicCache();
+   Mix_LockAudio();
+   for(i = 0; i < MUSICCACHESONGS; i++)
+   {
+      if(MusicCache[i].chunk)
+         SD_FreeMusicCache(&MusicCache[i]);
+   }
+   Mix_UnlockAudio();
+   for(i = 0; i < LASTMUSIC; i++)
+   {
+      free(MusicSnapshots[i]);
+      MusicSnapshots[i] = NULL;
+   }
+
    SD_Started = false;
 }
 
@@ -767,6 +2150,39 @@ void SD_PositionSound(int leftvol,int rightvol)
    nextsoundpos = true;
 }
 
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_SoundOrigin() - Sets the map position the next sound comes from,
+//              so a held sound can still be tracked once it's replayed
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_SoundOrigin(fixed gx, fixed gy)
+{
+   OriginX = gx;
+   OriginY = gy;
+   nextsoundorigin = true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_HoldCall() - queues a call of a speculative frame, or counts it
+//              as dropped when the queue is full
+//
+///////////////////////////////////////////////////////////////////////////
+static heldsound_t *SD_HoldCall(heldkind_t kind)
+{
+   heldsound_t *held;
+
+   if (NumHeldSounds == HELDSOUNDS)
+   {
+      audioStats.helddropped++;
+      return NULL;
+   }
+   held = &HeldSounds[NumHeldSounds++];
+   held->kind = kind;
+   return held;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //
 //      SD_PlaySound() - plays the specified sound on the appropriate hardware
@@ -781,10 +2197,29 @@ boolean SD_PlaySound(soundnames sound)
    RightPosition = 0;
    boolean ispos = nextsoundpos;
    nextsoundpos = false;
+   boolean hasorigin = nextsoundorigin;
+   nextsoundorigin = false;
 
    if (sound == -1 || (DigiMode == SDS_OFF && SoundMode == SDM_OFF))
       return 0;
 
+   if (speculative)
+   {
+      heldsound_t *held = SD_HoldCall(HELD_SOUND);
+
+      if (held)
+      {
+         held->sound      = sound;
+         held->leftpos    = lp;
+         held->rightpos   = rp;
+         held->positioned = ispos;
+         held->hasorigin  = hasorigin;
+         held->originx    = OriginX;
+         held->originy    = OriginY;
+      }
+      return 0;
+   }
+
    s = (SoundCommon *) SoundTable[sound];
 
    if ((SoundMode != SDM_OFF) && !s)
@@ -799,10 +2234,14 @@ boolean SD_PlaySound(soundnames sound)
       else
       {
 
-         int channel = SD_PlayDigitized(DigiMap[sound], lp, rp);
+         int channel;
+
+         DigiPriority = s->priority;
+         channel = SD_PlayDigitized(DigiMap[sound], lp, rp);
+         if(channel == -1)
+            return 0;
          SoundPositioned = ispos;
          DigiNumber = sound;
-         DigiPriority = s->priority;
          return channel + 1;
       }
 
@@ -820,9 +2259,7 @@ boolean SD_PlaySound(soundnames sound)
    switch (SoundMode)
    {
       case SDM_PC:
-#if 0
          SD_PCPlaySound((PCSound *)s);
-#endif
          break;
       case SDM_ADLIB:
          SD_ALPlaySound((AdLibSound *)s);
@@ -860,6 +2297,65 @@ word SD_SoundPlaying(void)
    return(false);
 }
 
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_CommitSounds() - carries out the sound and music calls a
+//              speculative frame held back, in order
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_CommitSounds(void)
+{
+   int i, channel;
+   heldsound_t *held;
+
+   for (i = 0; i < NumHeldSounds; i++)
+   {
+      held = &HeldSounds[i];
+      switch (held->kind)
+      {
+         case HELD_STOPSOUND:
+            SD_StopSound();
+            continue;
+         case HELD_MUSICON:
+            SD_MusicOn();
+            continue;
+         case HELD_MUSICOFF:
+            SD_MusicOff();
+            continue;
+         case HELD_STARTMUSIC:
+            SD_StartMusic(held->chunk);
+            continue;
+         case HELD_CONTINUEMUSIC:
+            SD_ContinueMusic(held->chunk, held->startoffs);
+            continue;
+         default:
+            break;
+      }
+
+      if (held->positioned)
+         SD_PositionSound(held->leftpos, held->rightpos);
+
+      channel = SD_PlaySound(held->sound);
+      if (channel && held->hasorigin)
+      {
+         channelSoundPos[channel - 1].globalsoundx = held->originx;
+         channelSoundPos[channel - 1].globalsoundy = held->originy;
+         channelSoundPos[channel - 1].valid = 1;
+      }
+   }
+   NumHeldSounds = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//
+//      SD_DropSounds() - forgets the sounds a speculative frame held back
+//
+///////////////////////////////////////////////////////////////////////////
+void SD_DropSounds(void)
+{
+   NumHeldSounds = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //
 //      SD_StopSound() - if a sound is playing, stops it
@@ -868,15 +2364,19 @@ word SD_SoundPlaying(void)
 void
 SD_StopSound(void)
 {
+   if (speculative)
+   {
+      SD_HoldCall(HELD_STOPSOUND);
+      return;
+   }
+
    if (DigiPlaying)
       SD_StopDigitized();
 
    switch (SoundMode)
    {
       case SDM_PC:
-#if 0
          SD_PCStopSound();
-#endif
          break;
       case SDM_ADLIB:
          SD_ALStopSound();
@@ -897,7 +2397,7 @@ void
 SD_WaitSoundDone(void)
 {
    while (SD_SoundPlaying())
-      rarch_sleep(5);
+      LR_Delay(5);
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -907,6 +2407,11 @@ SD_WaitSoundDone(void)
 ///////////////////////////////////////////////////////////////////////////
 void SD_MusicOn(void)
 {
+    if (speculative)
+    {
+       SD_HoldCall(HELD_MUSICON);
+       return;
+    }
     sqActive = true;
 }
 
@@ -914,17 +2419,50 @@ void SD_MusicOn(void)
 //
 //      SD_MusicOff() - turns off the sequencer and any playing notes
 //      returns the last music offset for music continue
+//      A streamed song fades out instead of stopping
 //
 ///////////////////////////////////////////////////////////////////////////
 int SD_MusicOff(void)
 {
    word    i;
+   boolean live;
+
+   if (speculative)
+   {
+      SD_HoldCall(HELD_MUSICOFF);
+      return (int) (sqHackPtr-sqHack);
+   }
 
+   Mix_LockAudio();
+   live     = sqActive && !mcStreaming;
    sqActive = false;
 
+   if(mcStreaming && mcPlaying && mcGain)
+   {
+      mcFadePos  = mcPos;
+      mcFadeGain = mcGain;
+      mcFading   = mcPlaying;
+   }
+   mcStreaming = false;
+
    switch (MusicMode)
    {
       case SMM_ADLIB:
+         if (sqFading)
+            break;                      /* leave the fading song alone */
+         if (live)
+         {
+            /* plays on from a copy of the sequencer while it fades */
+            sqFadeHack      = sqHack;
+            sqFadeSeqLen    = sqHackSeqLen;
+            sqFadePtr       = sqHackPtr;
+            sqFadeLen       = sqHackLen;
+            sqFadeTime      = sqHackTime;
+            sqFadeTimeCount = alTimeCount;
+            sqFadeLevel     = sqInLevel;
+            sqFading        = true;
+            break;
+         }
          YM3812Write(0, alEffects, 0);
          for (i = 0;i < sqMaxTracks;i++)
             YM3812Write(0, alFreqH + i + 1, 0);
@@ -932,10 +2470,181 @@ int SD_MusicOff(void)
       default:
          break;
    }
+   Mix_UnlockAudio();
 
    return (int) (sqHackPtr-sqHack);
 }
 
+/* Disables the play note and drum flags for writes replayed by a seek */
+static byte SD_SeekValue(byte reg, byte val)
+{
+   if(reg >= 0xb1 && reg <= 0xb8) val &= 0xdf;           /* disable play note flag */
+   else if(reg == 0xbd) val &= 0xe0;                     /* disable drum flags */
+   return val;
+}
+
+/*
+======================
+=
+= SD_BuildSnapshots
+=
+= Scans the register stream of a song once, the first time it is played
+=
+======================
+*/
+
+static void SD_BuildSnapshots(int chunk)
+{
+   int i, numwrites;
+   byte reg;
+   word *ptr = sqHack;
+   oplsnapshot_t *snap, state;
+
+   if(MusicSnapshots[chunk - STARTMUSIC])
+      return;
+
+   numwrites = sqHackSeqLen / 4;
+   snap = (oplsnapshot_t *) malloc((numwrites / SNAPSHOTWRITES + 1) * sizeof(*snap));
+   CHECKMALLOCRESULT(snap);
+   MusicSnapshots[chunk - STARTMUSIC] = snap;
+
+   memset(&state, 0, sizeof(state));
+   for(i = 0; i < numwrites; i++, ptr += 2)
+   {
+      if(i % SNAPSHOTWRITES == 0)
+         *snap++ = state;
+      reg = *(byte *)ptr;
+      state.regs[reg] = SD_SeekValue(reg, *(((byte *)ptr) + 1));
+      state.written[reg >> 3] |= 1 << (reg & 7);
+      state.ticks += (word)Retro_SwapLES16(*(ptr+1));
+   }
+   if(i % SNAPSHOTWRITES == 0)
+      *snap = state;
+   memcpy(MusicRegsUsed[chunk - STARTMUSIC], state.written, sizeof(state.written));
+}
+
+/* Register value as SD_DetectAdLib leaves the chip */
+static byte SD_OPLDefault(int reg)
+{
+   return reg == 1 ? 0x20 : 0;      /* WSE=1 */
+}
+
+/*
+======================
+=
+= SD_VerifySeek
+=
+= Replays the song from the start up to write and checks that the seek
+= left every register the song uses and the tick count the same way
+=
+======================
+*/
+
+static void SD_VerifySeek(int write, const byte *regs)
+{
+   int i, reg;
+   byte straight[256];
+   longword ticks = 0;
+   word *ptr = sqHack;
+   byte *used = MusicRegsUsed[sqChunk - STARTMUSIC];
+
+   for(reg = 0; reg < 256; reg++)
+      straight[reg] = SD_OPLDefault(reg);
+
+   for(i = 0; i < write; i++, ptr += 2)
+   {
+      reg = *(byte *)ptr;
+      straight[reg] = SD_SeekValue(reg, *(((byte *)ptr) + 1));
+      ticks += (word)Retro_SwapLES16(*(ptr+1));
+   }
+
+   if(ticks != sqTicks)
+      printf("SD_SeekMusic: song %d at write %d is at tick %u, not %u\n",
+            sqChunk - STARTMUSIC, write, sqTicks, ticks);
+
+   for(reg = 0; reg < 256; reg++)
+   {
+      if((used[reg >> 3] & (1 << (reg & 7))) && regs[reg] != straight[reg])
+      {
+         printf("SD_SeekMusic: song %d at write %d has register %02x at %02x, not %02x\n",
+               sqChunk - STARTMUSIC, write, reg, regs[reg], straight[reg]);
+         break;
+      }
+   }
+}
+
+/*
+======================
+=
+= SD_SeekMusic
+=
+= Moves the current song to a music offset as returned by SD_MusicOff,
+= reconstructing the instruments from the nearest snapshot. Registers the
+= song uses that the snapshot has not seen yet go back to their reset
+= values, so a backward seek leaves nothing of the later position behind.
+= The mixer callback writes them once the song plays on.
+=
+======================
+*/
+
+void SD_SeekMusic(int startoffs)
+{
+   int i, write, reg;
+   boolean active = sqActive;
+   oplsnapshot_t *snap;
+   byte regs[256];
+   byte *used;
+   byte val;
+
+   if(MusicMode != SMM_ADLIB || !sqHack || !MusicSnapshots[sqChunk - STARTMUSIC])
+      return;
+
+   if(startoffs < 0 || startoffs >= sqHackSeqLen / 2)
+      Quit("SD_SeekMusic: Illegal startoffs provided!");
+
+   sqActive = false;
+
+   write = startoffs / 2;
+   snap  = &MusicSnapshots[sqChunk - STARTMUSIC][write / SNAPSHOTWRITES];
+   used  = MusicRegsUsed[sqChunk - STARTMUSIC];
+
+   for(reg = 0; reg < 256; reg++)
+   {
+      if(snap->written[reg >> 3] & (1 << (reg & 7)))
+         regs[reg] = snap->regs[reg];
+      else
+         regs[reg] = SD_OPLDefault(reg);
+   }
+
+   i = write - write % SNAPSHOTWRITES;
+   sqHackPtr = sqHack + i * 2;
+   sqHackLen = sqHackSeqLen - i * 4;
+   sqTicks   = snap->ticks;
+
+   for(; i < write; i++)
+   {
+      reg = *(byte *)sqHackPtr;
+      val = SD_SeekValue(reg, *(((byte *)sqHackPtr) + 1));
+      regs[reg] = val;
+      sqTicks += (word)Retro_SwapLES16(*(sqHackPtr+1));
+      sqHackPtr += 2;
+      sqHackLen -= 4;
+   }
+   sqHackTime  = 0;
+   alTimeCount = 0;
+   mcPos       = sqTicks * samplesPerMusicTick;
+
+   if(YM3812Verify)
+      SD_VerifySeek(write, regs);
+
+   /* keys off every music channel, then sets the registers */
+   memcpy(sqSeekRegs, regs, sizeof(sqSeekRegs));
+   sqSeekUsed    = used;
+   sqSeekPending = true;
+
+   sqActive = active;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //
 //      SD_StartMusic() - starts playing the music pointed to
@@ -943,6 +2652,15 @@ int SD_MusicOff(void)
 ///////////////////////////////////////////////////////////////////////////
 void SD_StartMusic(int chunk)
 {
+   heldsound_t *held;
+
+   if (speculative)
+   {
+      if ((held = SD_HoldCall(HELD_STARTMUSIC)))
+         held->chunk = chunk;
+      return;
+   }
+
    SD_MusicOff();
 
    switch (MusicMode)
@@ -958,6 +2676,12 @@ void SD_StartMusic(int chunk)
             sqHackPtr    = sqHack;
             sqHackTime   = 0;
             alTimeCount  = 0;
+            sqTicks      = 0;
+            sqChunk      = chunk;
+            sqSeekPending = false;
+            mcStreaming  = false;
+            mcPlaying    = SD_CacheMusic(chunk);
+            SD_BuildSnapshots(chunk);
             SD_MusicOn();
          }
          break;
@@ -968,11 +2692,22 @@ void SD_StartMusic(int chunk)
 
 void SD_ContinueMusic(int chunk, int startoffs)
 {
+   heldsound_t *held;
+
+   if (speculative)
+   {
+      if ((held = SD_HoldCall(HELD_CONTINUEMUSIC)))
+      {
+         held->chunk     = chunk;
+         held->startoffs = startoffs;
+      }
+      return;
+   }
+
    SD_MusicOff();
 
    if (MusicMode == SMM_ADLIB)
    {
-      unsigned i;
       int32_t chunkLen = CA_CacheAudioChunk(chunk);
       sqHack = (word *)(void *) audiosegs[chunk];     /* alignment is correct */
       if((word)Retro_SwapLES16(*sqHack) == 0)
@@ -986,22 +2721,14 @@ void SD_ContinueMusic(int chunk, int startoffs)
          Quit("SD_StartMusic: Illegal startoffs provided!");
       }
 
+      sqChunk     = chunk;
+      mcStreaming = false;
+      mcPlaying   = SD_CacheMusic(chunk);
+      SD_BuildSnapshots(chunk);
+
       /* fast forward to correct position
        * (needed to reconstruct the instruments). */
-
-      for(i = 0; i < startoffs; i += 2)
-      {
-         byte reg = *(byte *)sqHackPtr;
-         byte val = *(((byte *)sqHackPtr) + 1);
-         if(reg >= 0xb1 && reg <= 0xb8) val &= 0xdf;           /* disable play note flag */
-         else if(reg == 0xbd) val &= 0xe0;                     /* disable drum flags */
-
-         YM3812Write(0, reg,val);
-         sqHackPtr += 2;
-         sqHackLen -= 4;
-      }
-      sqHackTime = 0;
-      alTimeCount = 0;
+      SD_SeekMusic(startoffs);
 
       SD_MusicOn();
    }
@@ -1018,7 +2745,7 @@ void SD_FadeOutMusic(void)
    switch (MusicMode)
    {
       case SMM_ADLIB:
-         /* DEBUG - quick hack to turn the music off */
+         /* streamed music crossfades, live music fades its levels */
          SD_MusicOff();
          break;
    }
@@ -1037,7 +2764,7 @@ boolean SD_MusicPlaying(void)
    switch (MusicMode)
    {
       case SMM_ADLIB:
-         result = sqActive;
+         result = sqActive || mcFading || sqFading;
          break;
       default:
          result = false;
@@ -32,6 +32,19 @@ typedef enum
    SDS_SOUNDBLASTER
 } SDSMode;
 
+typedef enum
+{
+   MCM_OFF = 0,
+   MCM_MEMORY,
+   MCM_DISK
+} MCMode;
+
+// Post chain stages, for DSPStages
+#define DSP_DCBLOCK     1
+#define DSP_LOWPASS     2
+#define DSP_REVERB      4
+#define DSP_LIMITER     8
+
 typedef struct
 {
    longword        length;
@@ -113,6 +126,26 @@ typedef struct
    fixed globalsoundx, globalsoundy;
 } globalsoundpos;
 
+// Mixer callback timing, see SD_GetAudioStats
+#define AUDIOHISTBUCKETS 11     // tenths of the buffer period, the last one overran
+
+typedef struct
+{
+   longword        callbacks;
+   longword        underruns;      // took longer than the buffer lasts
+   longword        nearmisses;     // took more than 3/4 of it
+   longword        periodusec;
+   longword        lastusec;
+   longword        maxusec;
+   int             load;           // last callback, percent of the period
+   int             peakload;
+   int             channels;       // digitized channels playing
+   int             oplchips;       // OPLs being rendered
+   int             samplerate;
+   longword        histogram[AUDIOHISTBUCKETS];
+   longword        helddropped;    // speculative calls that did not fit
+} audiostats_t;
+
 extern globalsoundpos channelSoundPos[];
 
 // Global variables
@@ -124,13 +157,15 @@ extern  SDSMode         DigiMode;
 extern  SMMode          MusicMode;
 extern  int             DigiMap[];
 extern  int             DigiChannel[];
+extern  MCMode          MusicCacheMode;
+extern  int             DSPStages;
 
 #define GetTimeCount()  ((LR_GetTicks()*7)/100)
 
 static inline void Delay(int wolfticks)
 {
    if(wolfticks>0)
-      rarch_sleep(wolfticks * 100 / 7);
+      LR_Delay(wolfticks * 100 / 7);
 }
 
 // Function prototypes
@@ -139,13 +174,17 @@ extern  void    SD_Startup(void),
 
 extern  int     SD_GetChannelForDigi(int which);
 extern  void    SD_PositionSound(int leftvol,int rightvol);
+extern  void    SD_SoundOrigin(fixed gx, fixed gy);
 extern  boolean SD_PlaySound(soundnames sound);
 extern  void    SD_SetPosition(int channel, int leftvol,int rightvol);
 extern  void    SD_StopSound(void),
         SD_WaitSoundDone(void);
+extern  void    SD_CommitSounds(void),
+        SD_DropSounds(void);
 
 extern  void    SD_StartMusic(int chunk);
 extern  void    SD_ContinueMusic(int chunk, int startoffs);
+extern  void    SD_SeekMusic(int startoffs);
 extern  void    SD_MusicOn(void),
         SD_FadeOutMusic(void);
 extern  int     SD_MusicOff(void);
@@ -158,6 +197,15 @@ extern  word    SD_SoundPlaying(void);
 extern  void    SD_SetDigiDevice(SDSMode);
 extern  void    SD_PrepareSound(int which);
 extern  int     SD_PlayDigitized(word which,int leftpos,int rightpos);
+extern  void    SD_ResampleBench(int runs);
 extern  void    SD_StopDigitized(void);
+extern  void    SD_SetEventTime(int32_t tic, word subtic);
+
+extern  void    SD_GetAudioStats(audiostats_t *stats);
+extern  void    SD_ResetAudioStats(void);
+extern  void    SD_ReportAudioStats(void);
+
+extern  int32_t SD_ResidentBytes(void);
+extern  void    SD_LevelWorkingSet(int *sounds, int32_t *bytes);
 
 #endif
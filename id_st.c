@@ -0,0 +1,365 @@
+// ID_ST.C
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+#include <signal.h>
+#include "wl_def.h"
+
+/*
+=============================================================================
+
+                             GLOBAL VARIABLES
+
+=============================================================================
+*/
+
+stslot_t    STGame;
+const char *STPath;
+int         STInterval = 1000;
+
+static int      STHandle = -1;
+static uint32_t STLastExport;       // ms
+static uint32_t STLastFrame;        // us
+static stslot_t STExported;         // STGame as of the last line
+
+const char *STLoadPath;
+int         STLoadBudget;
+int         STLoadsOver;
+
+typedef struct
+{
+    const char *name;
+    uint32_t    usec;
+    boolean     wait;           // deliberate, not counted against the budget
+} stphase_t;
+
+static const char *STLoading;       // NULL = no load being profiled
+static int         STLoadEpisode, STLoadMap;
+static uint32_t    STLoadStart, STLoadMark;    // us
+static stphase_t   STPhases[STMAXPHASES];
+static int         STNumPhases;
+
+
+/*
+======================
+=
+= ST_Frame
+=
+= Counts a 3D refresh and files the time since the last one
+=
+======================
+*/
+
+void ST_Frame (void)
+{
+   uint32_t now, ms;
+
+   if (STLoading)
+   {
+      ST_LoadPhase ("firstframe");
+      ST_LoadEnd ();
+   }
+
+   now = LR_GetMicroTicks ();
+   ms  = (now - STLastFrame) / 1000;
+
+   if (STLastFrame)
+      STGame.frametimes[ms < STFRAMEBUCKETS ? ms : STFRAMEBUCKETS - 1]++;
+   STLastFrame = now;
+   STGame.frames++;
+}
+
+
+/*
+======================
+=
+= ST_Percentile
+=
+= Frame time in ms below which percent of the interval's frames fall
+=
+======================
+*/
+
+static int ST_Percentile (const longword *hist, longword count, int percent)
+{
+   longword want = (count * percent + 99) / 100;
+   longword seen = 0;
+   int      ms;
+
+   for (ms = 0; ms < STFRAMEBUCKETS - 1; ms++)
+   {
+      seen += hist[ms];
+      if (seen >= want)
+         break;
+   }
+   return ms;
+}
+
+
+/*
+======================
+=
+= ST_Update
+=
+= Writes a line when the interval is up. The line is built on the stack
+= and goes out in a single write, a FIFO without a reader is retried on
+= the next interval rather than waited for. A write that fails, a reader
+= gone (EPIPE) or a full pipe (EAGAIN), closes the file so it is opened
+= again on the next interval.
+=
+======================
+*/
+
+void ST_Update (void)
+{
+   char         line[768];
+   longword     hist[STFRAMEBUCKETS];
+   longword     frames, tics, hits, misses, count;
+   audiostats_t audio;
+   uint32_t     now, elapsed;
+   int          i, len, maxms;
+
+   if (!STPath)
+      return;
+
+   now = LR_GetMicroTicks () / 1000;    // real time, whatever the game clock does
+   if (!STLastExport)
+   {
+      STExported   = STGame;     // the first interval starts now
+      STLastExport = now;
+      return;
+   }
+   elapsed = now - STLastExport;
+   if (elapsed < (uint32_t) STInterval)
+      return;
+
+   if (STHandle == -1)
+   {
+#ifdef O_NONBLOCK
+      STHandle = open (STPath, O_WRONLY | O_CREAT | O_APPEND | O_NONBLOCK, 0644);
+#else
+      STHandle = open (STPath, O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+      if (STHandle == -1)
+      {
+         STLastExport = now;
+         return;
+      }
+#ifdef SIGPIPE
+      // a reader that goes away must not kill the game, but leave a
+      // handler the host installed alone
+      {
+         void (*old) (int) = signal (SIGPIPE, SIG_IGN);
+         if (old != SIG_DFL && old != SIG_ERR)
+            signal (SIGPIPE, old);
+      }
+#endif
+   }
+
+   //
+   // rates and frame times cover the interval, counters are totals
+   //
+   frames = STGame.frames - STExported.frames;
+   tics   = STGame.tics - STExported.tics;
+   hits   = STGame.cachehits;
+   misses = STGame.cachemisses;
+
+   count = 0;
+   maxms = 0;
+   for (i = 0; i < STFRAMEBUCKETS; i++)
+   {
+      hist[i] = STGame.frametimes[i] - STExported.frametimes[i];
+      count  += hist[i];
+      if (hist[i])
+         maxms = i;
+   }
+
+   SD_GetAudioStats (&audio);
+
+   len = snprintf (line, sizeof(line),
+         "{\"time\":%u,\"interval\":%u,\"level\":%d,"
+         "\"fps\":%.1f,\"ticrate\":%.1f,"
+         "\"frame_ms\":{\"p50\":%d,\"p95\":%d,\"p99\":%d,\"max\":%d},"
+         "\"audio\":{\"callbacks\":%u,\"underruns\":%u,\"nearmisses\":%u,"
+         "\"load\":%d,\"peakload\":%d,\"helddropped\":%u},"
+         "\"cache\":{\"hits\":%u,\"misses\":%u},"
+         "\"memory\":{\"pages\":%d,\"sounds\":%d,\"cache\":%d,\"total\":%d}}\n",
+         now, elapsed, MMLevel,
+         frames * 1000.0 / elapsed, tics * 1000.0 / elapsed,
+         ST_Percentile (hist, count, 50), ST_Percentile (hist, count, 95),
+         ST_Percentile (hist, count, 99), maxms,
+         audio.callbacks, audio.underruns, audio.nearmisses,
+         audio.load, audio.peakload, audio.helddropped,
+         hits, misses,
+         PM_ResidentBytes (), SD_ResidentBytes (), CA_ResidentBytes (),
+         MM_Resident ());
+
+   if (len > 0 && len < (int) sizeof(line) && write (STHandle, line, len) != len)
+   {
+      close (STHandle);
+      STHandle = -1;
+   }
+
+   STExported   = STGame;
+   STLastExport = now;
+}
+
+
+/*
+======================
+=
+= ST_Shutdown
+=
+======================
+*/
+
+void ST_Shutdown (void)
+{
+   if (STHandle != -1)
+      close (STHandle);
+   STHandle = -1;
+
+   if (STLoadPath && STLoadBudget)
+      printf ("Load profile: %d loads over the %d ms budget\n", STLoadsOver, STLoadBudget);
+}
+
+
+/*
+=============================================================================
+
+                             LOAD PROFILER
+
+=============================================================================
+*/
+
+/*
+======================
+=
+= ST_LoadBegin
+=
+= Starts timing a load, what is "startup" or "level". One that is still
+= open, a level left before its first frame, is thrown away.
+=
+======================
+*/
+
+void ST_LoadBegin (const char *what, int episode, int map)
+{
+   if (!STLoadPath)
+      return;
+
+   STLoading     = what;
+   STLoadEpisode = episode;
+   STLoadMap     = map;
+   STNumPhases   = 0;
+   STLoadStart   = STLoadMark = LR_GetMicroTicks ();
+}
+
+
+/*
+======================
+=
+= ST_LoadMark
+=
+= Files the time since the last mark under name
+=
+======================
+*/
+
+static void ST_LoadMark (const char *name, boolean wait)
+{
+   uint32_t   now = LR_GetMicroTicks ();
+   stphase_t *phase;
+
+   if (!STLoading)
+      return;
+
+   if (STNumPhases < STMAXPHASES)
+   {
+      phase       = &STPhases[STNumPhases++];
+      phase->name = name;
+      phase->usec = 0;
+      phase->wait = wait;
+   }
+   else
+      phase = &STPhases[STMAXPHASES - 1];
+
+   phase->usec += now - STLoadMark;
+   STLoadMark   = now;
+}
+
+void ST_LoadPhase (const char *name)
+{
+   ST_LoadMark (name, false);
+}
+
+//
+// A phase that waits on purpose, fades and the "Get Psyched" pause. It is
+// reported but kept out of the loading time the budget applies to.
+//
+void ST_LoadWait (const char *name)
+{
+   ST_LoadMark (name, true);
+}
+
+
+/*
+======================
+=
+= ST_LoadEnd
+=
+= Appends the load as a line of JSON:
+=
+= {"load":"level","episode":1,"map":3,"total_us":..,"load_us":..,
+=  "wait_us":..,"over_budget":false,"phases":{"cachemap":..,...}}
+=
+======================
+*/
+
+void ST_LoadEnd (void)
+{
+   FILE    *file;
+   uint32_t loadusec, waitusec;
+   boolean  over;
+   int      i;
+
+   if (!STLoading)
+      return;
+
+   loadusec = waitusec = 0;
+   for (i = 0; i < STNumPhases; i++)
+   {
+      if (STPhases[i].wait)
+         waitusec += STPhases[i].usec;
+      else
+         loadusec += STPhases[i].usec;
+   }
+
+   over = STLoadBudget && loadusec > (uint32_t) STLoadBudget * 1000;
+   if (over)
+   {
+      STLoadsOver++;
+      printf ("Load profile: %s E%dM%d took %u ms, the budget is %d ms\n",
+            STLoading, STLoadEpisode, STLoadMap, loadusec / 1000, STLoadBudget);
+   }
+
+   file = fopen (STLoadPath, "a");
+   if (file)
+   {
+      fprintf (file, "{\"load\":\"%s\",\"episode\":%d,\"map\":%d,"
+            "\"total_us\":%u,\"load_us\":%u,\"wait_us\":%u,"
+            "\"over_budget\":%s,\"phases\":{",
+            STLoading, STLoadEpisode, STLoadMap,
+            STLoadMark - STLoadStart, loadusec, waitusec,
+            over ? "true" : "false");
+      for (i = 0; i < STNumPhases; i++)
+         fprintf (file, "%s\"%s\":%u", i ? "," : "", STPhases[i].name, STPhases[i].usec);
+      fprintf (file, "}}\n");
+      fclose (file);
+   }
+
+   STLoading = NULL;
+}
@@ -0,0 +1,43 @@
+// ID_ST.H
+//
+// Runtime statistics for monitoring. The game loop and the managers bump
+// counters in a preallocated slot that only the game thread writes, the
+// mixer keeps its own in the sound manager. Every STInterval milliseconds
+// ST_Update writes one line of JSON with the deltas to STPath, a file or
+// FIFO a monitoring agent can tail.
+//
+// The load profiler times startup and every level transition in named
+// phases and appends a line of JSON per load to STLoadPath.
+
+#ifndef __ID_ST__
+#define __ID_ST__
+
+#define STFRAMEBUCKETS  64      // frame times in ms, the last one is 63 and up
+#define STMAXPHASES     24      // phases per load, the rest are folded into the last
+
+typedef struct
+{
+    longword    frames;         // 3D refreshes
+    longword    tics;           // game tics simulated
+    longword    cachehits;      // CA_CacheGrChunk found the chunk resident
+    longword    cachemisses;
+    longword    frametimes[STFRAMEBUCKETS];
+} stslot_t;
+
+extern  stslot_t    STGame;
+extern  const char *STPath;         // NULL = no export
+extern  int         STInterval;     // ms between lines
+extern  const char *STLoadPath;     // NULL = no load profile
+extern  int         STLoadBudget;   // ms of loading allowed, 0 = no limit
+extern  int         STLoadsOver;    // loads that went over it
+
+void    ST_Frame (void);
+void    ST_Update (void);
+void    ST_Shutdown (void);
+
+void    ST_LoadBegin (const char *what, int episode, int map);
+void    ST_LoadPhase (const char *name);
+void    ST_LoadWait (const char *name);
+void    ST_LoadEnd (void);
+
+#endif
@@ -52,7 +52,7 @@ HighScore   Scores[MaxScores] =
 
 int rndindex = 0;
 
-static byte rndtable[] = {
+static const byte rndtable[] = {
       0,   8, 109, 220, 222, 241, 149, 107,  75, 248, 254, 140,  16,  66,
      74,  21, 211,  47,  80, 242, 154,  27, 205, 128, 161,  89,  77,  36,
      95, 110,  85,  48, 212, 140, 211, 249,  22,  79, 200,  50,  28, 188,
@@ -719,7 +719,7 @@ US_LineInput(int x,int y,char *buf,const char *def,boolean escok,
 
          cursorvis ^= true;
       }
-      else rarch_sleep(5);
+      else LR_Delay(5);
       if (cursorvis)
          USL_XORICursor(x,y,s,cursor);
 
@@ -188,7 +188,7 @@ void LatchDrawPic (unsigned x, unsigned y, unsigned picnum)
 
 void LatchDrawPicScaledCoord (unsigned scx, unsigned scy, unsigned picnum)
 {
-   VL_LatchToScreenScaledCoord2(&latchpics[2+picnum-LATCHPICS_LUMP_START], scx*8, scy);
+   VL_LatchToScreenScaledCoord2(&latchpics[2+picnum-LATCHPICS_LUMP_START], scx, scy);
 }
 
 
@@ -283,8 +283,6 @@ static const uint32_t rndmasks[] = {
 static unsigned int rndbits_y;
 static unsigned int rndmask;
 
-extern LR_Color curpal[256];
-
 /* Returns the number of bits needed to represent the given value */
 static int log2_ceil(uint32_t x)
 {
@@ -315,15 +313,13 @@ void VH_Startup(void)
    rndmask = rndmasks[rndbits - 17];
 }
 
-static boolean FizzleFadeFinish(LR_Surface *source_copy, LR_Surface *screen_copy)
+static boolean FizzleFadeFinish(LR_Surface *source_copy, boolean aborted)
 {
    VL_UnlockSurface(source_copy);
-   VL_UnlockSurface(screen_copy);
-   VL_ScreenToScreen(screen_copy, screenBuffer);
+   VL_UnlockSurface(screenBuffer);
    VW_UpdateScreen();
    LR_FreeSurface(source_copy->surf);
-   LR_FreeSurface(screen_copy->surf);
-   return false;
+   return aborted;
 }
 
 boolean FizzleFade (LR_Surface *source, int x1, int y1,
@@ -331,9 +327,9 @@ boolean FizzleFade (LR_Surface *source, int x1, int y1,
 {
    unsigned x, y, frame;
    int32_t  rndval;
-   unsigned i, p;
-   LR_Surface source_copy, screen_copy;
-   byte *srcptr;
+   unsigned p;
+   LR_Surface source_copy;
+   byte *srcptr, *destptr;
    int32_t lastrndval = 0;
    unsigned pixperframe = width * height / frames;
 
@@ -341,36 +337,25 @@ boolean FizzleFade (LR_Surface *source, int x1, int y1,
 
    frame       = GetTimeCount();
 
-   /* can't rely on screen as dest b/c crt.cpp writes over it with screenBuffer
-    * can't rely on screenBuffer as source for same reason: every flip it has to be updated
+   /* source is usually screenBuffer itself, so keep the new picture aside
+    * and start over from the frame on display, which only shownBuffer holds.
+    * The fade then runs in 8 bits on screenBuffer and shows each step with
+    * VW_UpdateScreen
     */
    source_copy.surf = LR_ConvertSurface(source, source->surf->format, source->surf->flags);
-   screen_copy.surf = LR_ConvertSurface(screen, screen->surf->format, screen->surf->flags);
    srcptr      = VL_LockSurface(&source_copy);
+   destptr     = VL_LockSurface(screenBuffer);
+   memcpy(destptr, shownBuffer->surf->pixels, bufferPitch * screenHeight);
 
    do
    {
-      byte *destptr;
-
       if(abortable && IN_CheckAck ())
-      {
-         VL_UnlockSurface(&source_copy);
-         VL_ScreenToScreen(&screen_copy, screenBuffer);
-         VW_UpdateScreen();
+         return FizzleFadeFinish(&source_copy, true);
 
-         LR_FreeSurface(source_copy.surf);
-         LR_FreeSurface(screen_copy.surf);
-         return true;
-      }
-
-      destptr = VL_LockSurface(&screen_copy);
       rndval  = lastrndval;
 
       for(p = 0; p < pixperframe; p++)
       {
-         byte col;
-         uint32_t fullcol;
-
          /* seperate random value into x/y pair */
          x = rndval >> rndbits_y;
          y = rndval & ((1 << rndbits_y) - 1);
@@ -381,30 +366,28 @@ boolean FizzleFade (LR_Surface *source, int x1, int y1,
          if(x >= width || y >= height)
          {
             if(rndval == 0)     /* entire sequence has been completed */
-               return FizzleFadeFinish(&source_copy, &screen_copy);
+               return FizzleFadeFinish(&source_copy, false);
             p--;
             continue;
          }
 
          /* copy one pixel */
-         col     = *(srcptr + (y1 + y) * source->surf->pitch + x1 + x);
-         fullcol = LR_MapRGB(screen->surf->format, curpal[col].r, curpal[col].g, curpal[col].b);
-         memcpy(destptr + (y1 + y) * screen->surf->pitch + (x1 + x) * screen->surf->format->BytesPerPixel,
-               &fullcol, screen->surf->format->BytesPerPixel);
+         destptr[(y1 + y) * bufferPitch + x1 + x] =
+            srcptr[(y1 + y) * source_copy.surf->pitch + x1 + x];
 
          if(rndval == 0)     /* entire sequence has been completed */
-            return FizzleFadeFinish(&source_copy, &screen_copy);
+            return FizzleFadeFinish(&source_copy, false);
       }
 
       lastrndval = rndval;
 
-      VL_UnlockSurface(&screen_copy);
-      VL_ScreenToScreen(&screen_copy, screenBuffer);
+      VL_UnlockSurface(screenBuffer);
       VW_UpdateScreen();
+      destptr = VL_LockSurface(screenBuffer);
 
       frame++;
       Delay(frame - GetTimeCount()); /* don't go too fast */
    } while (1);
 
-   return FizzleFadeFinish(&source_copy, &screen_copy);
+   return FizzleFadeFinish(&source_copy, false);
 }
@@ -13,6 +13,7 @@ unsigned screenHeight = 200;
 LR_Surface *screen = NULL;
 #endif
 LR_Surface *screenBuffer = NULL;
+LR_Surface *shownBuffer = NULL;         // screenBuffer as last presented
 unsigned bufferPitch;
 
 unsigned scaleFactor;
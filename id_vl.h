@@ -23,6 +23,7 @@ void Quit (const char *error,...);
 
 extern LR_Surface *screen;
 extern LR_Surface *screenBuffer;
+extern LR_Surface *shownBuffer;
 
 extern  boolean  fullscreen;
 extern  unsigned screenWidth, screenHeight, screenBits, bufferPitch;
@@ -40,6 +41,7 @@ extern LR_Color gamepal[256];
 //
 
 void VL_WaitVBL(int vbls);
+void VL_ReleasePresent(boolean show);
 
 void VL_SetTextMode (void);
 void VL_Startup (void);
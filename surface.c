@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <stdlib.h>
 
 #if defined(__CELLOS_LV2__) && !defined(__PSL1GHT__)
 #include <sys/timer.h>
@@ -21,6 +22,15 @@
 
 typedef uint64_t retro_perf_tick_t;
 
+#ifdef __LIBRETRO__
+static retro_environment_t   lr_environ_cb;
+static retro_video_refresh_t lr_video_cb;
+
+/* Used when the frontend can't lend us its framebuffer */
+static uint16_t *lr_framebuf;
+static unsigned  lr_framebuf_size;
+#endif
+
 /* forward decls */
 int SDL_Flip(SDL_Surface* screen);
 SDL_Surface *SDL_SetVideoMode(int width, int height, int bpp, Uint32 flags);
@@ -102,12 +112,85 @@ static retro_perf_tick_t rarch_get_perf_counter(void)
    time_ticks = (1000000 * tv_sec + tv_usec);
 #endif
 
-   return time_ticks / 1000000;
+   return time_ticks;
+}
+
+/*
+ * The game clock. Everything that paces the game reads LR_GetTicks and
+ * waits with LR_Delay, so the source of time can be swapped:
+ *
+ * LR_CLOCK_REAL     the monotonic counter, scaled by rate for fast-forward
+ * LR_CLOCK_HOST     moves only when the host calls LR_AdvanceClock, waits
+ *                   yield to the host
+ * LR_CLOCK_VIRTUAL  moves only by what is waited for, so the game runs as
+ *                   fast as it can and the same way every time
+ *
+ * Switching keeps the time continuous. LR_GetMicroTicks and LR_GetRealTicks
+ * stay on the real counter, they measure how long code takes and time the
+ * mixer, not the game. The clock state belongs to the game thread, so the
+ * mixer thread must only use those two.
+ */
+static LR_ClockSource lr_clock = LR_CLOCK_REAL;
+static unsigned       lr_clockrate = 100;  /* percent, real clock only */
+static uint64_t       lr_clockbase;        /* game usec when the source was set */
+static uint64_t       lr_realbase;         /* real usec at that point */
+static uint64_t       lr_clockusec;        /* host and virtual time */
+static void         (*lr_yield)(void);
+
+static uint64_t LR_RealMicroTicks(void)
+{
+   return rarch_get_perf_counter() / 1000;
+}
+
+static uint64_t LR_ClockMicroTicks(void)
+{
+   if (lr_clock != LR_CLOCK_REAL)
+      return lr_clockusec;
+   return lr_clockbase + (LR_RealMicroTicks() - lr_realbase) * lr_clockrate / 100;
+}
+
+void LR_SetClock(LR_ClockSource source, unsigned rate)
+{
+   uint64_t now  = LR_ClockMicroTicks();
+
+   lr_clock      = source;
+   lr_clockrate  = rate ? rate : 100;
+   lr_clockbase  = now;
+   lr_clockusec  = now;
+   lr_realbase   = LR_RealMicroTicks();
+}
+
+void LR_AdvanceClock(uint32_t usec)
+{
+   if (lr_clock != LR_CLOCK_REAL)
+      lr_clockusec += usec;
+}
+
+void LR_SetYieldCallback(void (*yield)(void))
+{
+   lr_yield = yield;
 }
 
 uint32_t LR_GetTicks(void)
 {
-   return (uint32_t)rarch_get_perf_counter();
+   return (uint32_t)(LR_ClockMicroTicks() / 1000);
+}
+
+/* Milliseconds on the real counter, whatever the game clock does */
+uint32_t LR_GetRealTicks(void)
+{
+   return (uint32_t)(LR_RealMicroTicks() / 1000);
+}
+
+/* How many times as fast as real time the game clock runs, in percent */
+unsigned LR_GetClockRate(void)
+{
+   return lr_clock == LR_CLOCK_REAL ? lr_clockrate : 100;
+}
+
+uint32_t LR_GetMicroTicks(void)
+{
+   return (uint32_t)LR_RealMicroTicks();
 }
 
 void LR_FillRect(LR_Surface *surface, const void *rect_data, uint32_t color)
@@ -124,7 +207,23 @@ void LR_FillRect(LR_Surface *surface, const void *rect_data, uint32_t color)
 
 void LR_Delay(uint32_t ms)
 {
-   rarch_sleep(ms);
+   switch (lr_clock)
+   {
+      case LR_CLOCK_HOST:
+         if (lr_yield)
+         {
+            /* the host runs and moves the clock on */
+            lr_yield();
+            break;
+         }
+         /* nobody to yield to, move it ourselves */
+      case LR_CLOCK_VIRTUAL:
+         lr_clockusec += (uint64_t)ms * 1000;
+         break;
+      default:
+         rarch_sleep(ms * 100 / lr_clockrate);
+         break;
+   }
 }
 
 void LR_SetPalette(SDL_Surface *surface, int flags, LR_Color *colors, int firstcolor, int ncolors)
@@ -149,6 +248,9 @@ int LR_Init(uint32_t flags)
 void LR_Quit(void)
 {
 #ifdef __LIBRETRO__
+   free(lr_framebuf);
+   lr_framebuf      = NULL;
+   lr_framebuf_size = 0;
    SDL_Quit();
 #endif
 }
@@ -186,6 +288,82 @@ int LR_Flip(LR_Surface *screen)
 #endif
 }
 
+#ifdef __LIBRETRO__
+/* The frontend hands the core its callbacks through these entry points,
+ * before retro_init. LR_Present draws with them. */
+void retro_set_environment(retro_environment_t cb)
+{
+   lr_environ_cb = cb;
+}
+
+void retro_set_video_refresh(retro_video_refresh_t cb)
+{
+   lr_video_cb = cb;
+}
+
+/**
+ * LR_Present:
+ * @src          : 8-bit paletted frame
+ * @pal          : RGB565 value of each palette index
+ *
+ * Expands @src through @pal and hands the frame to the frontend.
+ * If the frontend lends us its software framebuffer the pixels are
+ * written straight into it, so no intermediate 16-bit copy of the
+ * frame exists. Otherwise an internal buffer is used.
+ * Returns -1 while the frontend has not set a video refresh callback.
+ **/
+int LR_Present(LR_Surface *src, const unsigned short *pal)
+{
+   struct retro_framebuffer fb = {0};
+   SDL_Surface *surf = src->surf;
+   unsigned width    = surf->w;
+   unsigned height   = surf->h;
+   unsigned x, y;
+   uint16_t *dest;
+   size_t pitch;
+
+   if (!lr_video_cb)
+      return -1;
+
+   fb.width        = width;
+   fb.height       = height;
+   fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+
+   if (lr_environ_cb
+         && lr_environ_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fb)
+         && fb.data && fb.format == RETRO_PIXEL_FORMAT_RGB565)
+   {
+      dest  = (uint16_t*)fb.data;
+      pitch = fb.pitch;
+   }
+   else
+   {
+      if (lr_framebuf_size < width * height)
+      {
+         free(lr_framebuf);
+         lr_framebuf      = (uint16_t*)malloc(width * height * sizeof(uint16_t));
+         lr_framebuf_size = lr_framebuf ? width * height : 0;
+         if (!lr_framebuf)
+            return -1;
+      }
+      dest  = lr_framebuf;
+      pitch = width * sizeof(uint16_t);
+   }
+
+   for (y = 0; y < height; y++)
+   {
+      const uint8_t *in = (const uint8_t*)surf->pixels + y * surf->pitch;
+      uint16_t *out     = (uint16_t*)((uint8_t*)dest + y * pitch);
+
+      for (x = 0; x < width; x++)
+         out[x] = pal[in[x]];
+   }
+
+   lr_video_cb(dest, width, height, pitch);
+   return 0;
+}
+#endif
+
 SDL_Surface *LR_SetVideoMode(int width, int height, int bpp, uint32_t flags)
 {
    return SDL_SetVideoMode(width, height, bpp, flags);
@@ -5,6 +5,10 @@
 
 #include "LRSDL.h"
 
+#ifdef __LIBRETRO__
+#include "libretro.h"
+#endif
+
 extern unsigned short d_8to16table[256];
 
 #define MAKECOLOR(r, g, b) (((r & 0xf8) << 8) | ((g & 0xfc) << 3) | ((b & 0xf8) >> 3))
@@ -32,8 +36,27 @@ typedef struct LR_Color
 
 #define SET_COLORFORMAT(r, g, b) ((r >> RED_EXPAND) << RED_SHIFT | (g >> GREEN_EXPAND) << GREEN_SHIFT | (b >> BLUE_EXPAND) << BLUE_SHIFT)
 
+typedef enum
+{
+   LR_CLOCK_REAL = 0,
+   LR_CLOCK_HOST,
+   LR_CLOCK_VIRTUAL
+} LR_ClockSource;
+
+void LR_SetClock(LR_ClockSource source, unsigned rate);
+
+void LR_AdvanceClock(uint32_t usec);
+
+void LR_SetYieldCallback(void (*yield)(void));
+
 uint32_t LR_GetTicks(void);
 
+uint32_t LR_GetRealTicks(void);
+
+unsigned LR_GetClockRate(void);
+
+uint32_t LR_GetMicroTicks(void);
+
 void LR_FillRect(LR_Surface *surface, const void *rect_data, uint32_t color);
 
 void LR_Delay(Uint32 ms);
@@ -61,6 +84,10 @@ int LR_BlitSurface(LR_Surface *src, SDL_Rect *srcrect, LR_Surface *dst, SDL_Rect
 
 int LR_Flip(LR_Surface *screen);
 
+#ifdef __LIBRETRO__
+int LR_Present(LR_Surface *src, const unsigned short *pal);
+#endif
+
 SDL_Surface *LR_SetVideoMode(int width, int height, int bpp, uint32_t flags);
 
 SDL_Surface *LR_ConvertSurface(LR_Surface *src, SDL_PixelFormat *fmt, uint32_t flags);
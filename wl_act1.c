@@ -757,6 +757,7 @@ void PushWall (int checkx, int checky, int dir)
    pwalltile = tilemap[pwallx][pwally];
    tilemap[pwallx][pwally] = 64;
    tilemap[pwallx+dx][pwally+dy] = 64;
+   TileChanged (pwallx+dx,pwally+dy);
    *(mapsegs[1]+(pwally<<mapshift)+pwallx) = 0;   // remove P tile info
    *(mapsegs[0]+(pwally<<mapshift)+pwallx) = *(mapsegs[0]+(player->tiley<<mapshift)+player->tilex); // set correct floorcode (BrotherTank's fix)
 
@@ -792,6 +793,7 @@ void MovePWalls (void)
       // the tile can now be walked into
       tilemap[pwallx][pwally] = 0;
       actorat[pwallx][pwally] = 0;
+      TileChanged (pwallx,pwally);
       *(mapsegs[0]+(pwally<<mapshift)+pwallx) = player->areanumber+AREATILE;
 
       int dx=dirs[pwalldir][0], dy=dirs[pwalldir][1];
@@ -802,6 +804,7 @@ void MovePWalls (void)
          // the block has been pushed two tiles
          pwallstate = 0;
          tilemap[pwallx+dx][pwally+dy] = oldtile;
+         BuildTileDist ();
          return;
       }
       else
@@ -820,10 +823,12 @@ void MovePWalls (void)
          {
             pwallstate = 0;
             tilemap[pwallx][pwally] = oldtile;
+            BuildTileDist ();
             return;
          }
          actorat[pwallx+dx][pwally+dy] = (objtype *)(uintptr_t) (tilemap[pwallx+dx][pwally+dy] = oldtile);
          tilemap[pwallx+dx][pwally+dy] = 64;
+         TileChanged (pwallx+dx,pwally+dy);
       }
    }
 
@@ -243,6 +243,151 @@ static void ControlMovement (objtype *ob)
 */
 
 
+/*
+   The status bar is composited once at screen scale into statusimage.
+   statuscell remembers which pic was last drawn at each 8 pixel cell, so
+   redrawing an unchanged field costs nothing and a changed digit is a
+   memcpy of its scaled rows into the screen and the composite.
+*/
+
+#define STATUSCELLS     (320/8)
+#define NOSTATUSPIC     0xffff
+#define NUMSTATUSPICS   (LATCHPICS_LUMP_END-LATCHPICS_LUMP_START+1)
+
+static byte     *statusimage;
+static word     statuscell[STATUSCELLS][STATUSLINES];
+static byte     *statuspics[NUMSTATUSPICS];
+static unsigned statusscale;            // scaleFactor the caches were built for
+
+
+/*
+==================
+=
+= StatusScaledPic
+=
+= Returns the latch pic scaled by scaleFactor, scaling it on first use
+=
+==================
+*/
+
+static byte *StatusScaledPic (unsigned picnum, unsigned *scwidth, unsigned *scheight)
+{
+   LR_Surface *latch = &latchpics[2+picnum-LATCHPICS_LUMP_START];
+   byte       *pic   = statuspics[picnum-LATCHPICS_LUMP_START];
+   unsigned    x, y;
+
+   *scwidth  = latch->surf->w * scaleFactor;
+   *scheight = latch->surf->h * scaleFactor;
+
+   if (!pic)
+   {
+      byte     *src      = VL_LockSurface(latch);
+      unsigned  srcpitch = latch->surf->pitch;
+
+      pic = (byte *) malloc(*scwidth * *scheight);
+      CHECKMALLOCRESULT(pic);
+
+      for (y = 0; y < *scheight; y++)
+         for (x = 0; x < *scwidth; x++)
+            pic[y * *scwidth + x] = src[(y / scaleFactor) * srcpitch + x / scaleFactor];
+
+      VL_UnlockSurface(latch);
+      statuspics[picnum-LATCHPICS_LUMP_START] = pic;
+   }
+
+   return pic;
+}
+
+
+/*
+==================
+=
+= StatusInvalidate
+=
+= Forgets which pics are in the cells, for code that paints the bare bar
+= without StatusDrawBar. The next Draw* call repaints every field.
+=
+==================
+*/
+
+void StatusInvalidate (void)
+{
+   memset(statuscell, 0xff, sizeof(statuscell));
+}
+
+
+/*
+==================
+=
+= StatusShutdown
+=
+= Frees the composite and the scaled pics
+=
+==================
+*/
+
+void StatusShutdown (void)
+{
+   unsigned i;
+
+   free(statusimage);
+   statusimage = NULL;
+
+   for (i = 0; i < NUMSTATUSPICS; i++)
+   {
+      free(statuspics[i]);
+      statuspics[i] = NULL;
+   }
+}
+
+
+/*
+==================
+=
+= StatusDrawBar
+=
+= Puts the status bar with all its fields on screen. The first call draws
+= STATUSBARPIC and keeps a copy, later calls just copy it back.
+=
+==================
+*/
+
+void StatusDrawBar (void)
+{
+   unsigned scwidth  = scaleFactor * 320;
+   unsigned scheight = scaleFactor * STATUSLINES;
+   unsigned scx      = (screenWidth - scwidth) / 2;
+   unsigned scy      = screenHeight - scheight;
+   unsigned y;
+   byte    *vbuf;
+
+   if (statusimage && statusscale != scaleFactor)
+      StatusShutdown ();
+
+   if (!statusimage)
+   {
+      statusscale = scaleFactor;
+      statusimage = (byte *) malloc(scwidth * scheight);
+      CHECKMALLOCRESULT(statusimage);
+
+      VWB_DrawPicScaledCoord (scx, scy, STATUSBARPIC);
+
+      vbuf = VL_LockSurface(screenBuffer);
+      for (y = 0; y < scheight; y++)
+         memcpy(statusimage + y * scwidth, vbuf + (scy + y) * bufferPitch + scx, scwidth);
+      VL_UnlockSurface(screenBuffer);
+
+      StatusInvalidate ();
+      return;
+   }
+
+   vbuf = VL_LockSurface(screenBuffer);
+   for (y = 0; y < scheight; y++)
+      memcpy(vbuf + (scy + y) * bufferPitch + scx, statusimage + y * scwidth, scwidth);
+   VL_UnlockSurface(screenBuffer);
+}
+
+
 /*
 ==================
 =
@@ -253,8 +398,37 @@ static void ControlMovement (objtype *ob)
 
 void StatusDrawPic (unsigned x, unsigned y, unsigned picnum)
 {
-   LatchDrawPicScaledCoord ((screenWidth-scaleFactor*320)/16 + scaleFactor*x,
-         screenHeight-scaleFactor*(STATUSLINES-y),picnum);
+   unsigned scwidth, scheight, scx, scy, row;
+   unsigned statusw = scaleFactor * 320;
+   byte    *pic, *vbuf;
+
+   if (statusimage && statusscale != scaleFactor)
+      StatusShutdown ();
+
+   if (!statusimage)
+   {
+      LatchDrawPicScaledCoord ((screenWidth-statusw)/2 + scaleFactor*x*8,
+            screenHeight-scaleFactor*(STATUSLINES-y),picnum);
+      return;
+   }
+
+   if (statuscell[x][y] == picnum)
+      return;
+   statuscell[x][y] = picnum;
+
+   pic  = StatusScaledPic (picnum, &scwidth, &scheight);
+   scx  = scaleFactor * x * 8;
+   scy  = scaleFactor * y;
+
+   vbuf = VL_LockSurface(screenBuffer) + (screenHeight - scaleFactor * STATUSLINES + scy) * bufferPitch
+      + (screenWidth - statusw) / 2 + scx;
+
+   for (row = 0; row < scheight; row++)
+   {
+      memcpy(vbuf + row * bufferPitch, pic + row * scwidth, scwidth);
+      memcpy(statusimage + (scy + row) * statusw + scx, pic + row * scwidth, scwidth);
+   }
+   VL_UnlockSurface(screenBuffer);
 }
 
 void StatusDrawFace(unsigned picnum)
@@ -71,6 +71,8 @@ typedef struct
 
 void Quit(const char *errorStr, ...);
 
+#include "id_mm.h"
+#include "id_st.h"
 #include "id_pm.h"
 #include "id_sd.h"
 #include "id_in.h"
@@ -871,6 +873,8 @@ extern  int      viewheight;
 extern  short    centerx;
 extern  int32_t  heightnumerator;
 extern  fixed    scale;
+extern  int      refviewwidth;
+extern  unsigned weaponheight;
 
 extern  int      dirangle[9];
 
@@ -882,6 +886,7 @@ extern  boolean  startgame;
 extern  char     str[80];
 extern  char     configdir[256];
 extern  char     configname[13];
+extern  boolean  speculative;
 
 //
 // Command line parameter variables
@@ -895,6 +900,9 @@ extern  int      param_joystickhat;
 extern  int      param_mission;
 extern  boolean  param_goodtimes;
 extern  boolean  param_ignorenumchunks;
+extern  int      param_fov;
+extern  char    *param_renderbench;
+extern  int      param_decodebench;
 
 
 void            NewGame (int difficulty,int episode);
@@ -903,6 +911,11 @@ boolean         LoadTheGame(FILE *file,int x,int y);
 boolean         SaveTheGame(FILE *file,int x,int y);
 void            ShowViewSize (int width);
 void            ShutdownId (void);
+void            BeginSpeculativeFrame (void);
+void            CommitSpeculativeFrame (void);
+void            DropSpeculativeFrame (void);
+FILE           *OpenSaveFile (const char *path);
+void            CloseSaveFile (FILE *file);
 
 
 /*
@@ -919,6 +932,8 @@ extern  LR_Surface     latchpics[NUMLATCHPICS];
 extern  char            demoname[13];
 
 void    SetupGameLevel (void);
+void    BuildTileDist (void);
+void    TileChanged (int tilex, int tiley);
 int    GameLoop (void);
 void    DrawPlayBorder (void);
 void    DrawStatusBorder (byte color);
@@ -928,6 +943,7 @@ void    ShowActStatus();
 
 void    PlayDemo (int demonumber);
 void    RecordDemo (void);
+int     RenderBench (const char *path);
 
 
 #ifdef SPEAR
@@ -958,8 +974,30 @@ void UpdateSoundLoc(void);
 
 #define JOYSCALE                2
 
+//
+// frame scheduler policies, see FrameWanted
+//
+typedef enum
+{
+    FS_RENDERALL,               // a 3D refresh every frame
+    FS_SKIP,                    // drop refreshes so the sim steps stay small
+    FS_LOWRES,                  // trace every other column
+    FS_ADAPTIVE                 // lower the resolution first, then skip
+} framepolicy_t;
+
+typedef struct
+{
+    longword    frames;         // sim steps
+    longword    skipped;        // steps without a 3D refresh
+    longword    lowres;         // refreshes at half resolution
+    longword    switches;       // times half resolution kicked in
+    longword    simusec;        // smoothed cost of a sim step
+    longword    renderusec;     // smoothed cost of a 3D refresh
+} framestats_t;
+
 extern  byte            tilemap[MAPSIZE][MAPSIZE];      // wall values only
 extern  byte            spotvis[MAPSIZE][MAPSIZE];
+extern  byte            tiledist[MAPSIZE][MAPSIZE];     // empty tiles around a spot
 extern  objtype         *actorat[MAPSIZE][MAPSIZE];
 
 extern  objtype         *player;
@@ -1023,6 +1061,12 @@ extern  objtype     *objfreelist;     // *obj,*player,*lastobj,
 
 extern  boolean     noclip,ammocheat;
 
+extern  framepolicy_t framepolicy;
+extern  int         framebudget;
+extern  framestats_t framestats;
+
+void    ReportFrameStats (void);
+
 /*
 =============================================================================
 
@@ -1074,7 +1118,8 @@ extern  int32_t    frameon;
 
 extern  unsigned screenloc[3];
 
-extern  boolean fizzlein, fpscounter;
+extern  boolean fizzlein, fpscounter, audiooverlay;
+extern  int     raystep;                        // columns per traced ray
 
 extern  fixed   viewx,viewy;                    // the focal point
 extern  fixed   viewsin,viewcos;
@@ -1145,6 +1190,9 @@ void    GiveKey (int key);
 // player state info
 //
 
+void    StatusDrawBar (void);
+void    StatusInvalidate (void);
+void    StatusShutdown (void);
 void    StatusDrawFace(unsigned picnum);
 void    DrawFace (void);
 void    DrawHealth (void);
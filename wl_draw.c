@@ -16,6 +16,49 @@
 
 #define ACTORSIZE       0x4000
 
+/*
+** With SIMDRAYS, AsmRefresh walks RAYLANES neighbouring rays together
+** through empty tiles and then finishes each one in column order. It is
+** only built where SSE2 or NEON is there to step the lanes.
+*/
+#define RAYLANES        4
+
+#if defined(SIMDRAYS) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define RAYPACKET
+typedef __m128i rayvec;
+#define V_ZERO          _mm_setzero_si128()
+#define V_DUP(x)        _mm_set1_epi32(x)
+#define V_ADD(a,b)      _mm_add_epi32(a,b)
+#define V_SUB(a,b)      _mm_sub_epi32(a,b)
+#define V_AND(a,b)      _mm_and_si128(a,b)
+#define V_ANDNOT(a,b)   _mm_andnot_si128(b,a)   /* a & ~b */
+#define V_OR(a,b)       _mm_or_si128(a,b)
+#define V_XOR(a,b)      _mm_xor_si128(a,b)
+#define V_SRA(a,n)      _mm_srai_epi32(a,n)
+#define V_SRL(a,n)      _mm_srli_epi32(a,n)
+#define V_SHL(a,n)      _mm_slli_epi32(a,n)
+#define V_SEL(m,a,b)    _mm_or_si128(_mm_and_si128(m,a),_mm_andnot_si128(m,b))
+#define V_ISZERO(a)     _mm_cmpeq_epi32(a,_mm_setzero_si128())
+#elif defined(SIMDRAYS) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define RAYPACKET
+typedef int32x4_t rayvec;
+#define V_ZERO          vdupq_n_s32(0)
+#define V_DUP(x)        vdupq_n_s32(x)
+#define V_ADD(a,b)      vaddq_s32(a,b)
+#define V_SUB(a,b)      vsubq_s32(a,b)
+#define V_AND(a,b)      vandq_s32(a,b)
+#define V_ANDNOT(a,b)   vbicq_s32(a,b)          /* a & ~b */
+#define V_OR(a,b)       vorrq_s32(a,b)
+#define V_XOR(a,b)      veorq_s32(a,b)
+#define V_SRA(a,n)      vshrq_n_s32(a,n)
+#define V_SRL(a,n)      vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a),n))
+#define V_SHL(a,n)      vshlq_n_s32(a,n)
+#define V_SEL(m,a,b)    vbslq_s32(vreinterpretq_u32_s32(m),a,b)
+#define V_ISZERO(a)     vreinterpretq_s32_u32(vceqq_s32(a,vdupq_n_s32(0)))
+#endif
+
 /*
 =============================================================================
 
@@ -30,6 +73,7 @@ unsigned vbufPitch = 0;
 int32_t    lasttimecount;
 int32_t    frameon;
 boolean fpscounter;
+boolean audiooverlay;
 
 int fps_frames=0, fps_time=0, fps=0;
 
@@ -61,6 +105,7 @@ short   midangle,angle;
 
 word    tilehit;
 int     pixx;
+int     raystep = 1;            /* 2 traces every other column, see FrameWanted */
 
 short   xtile,ytile;
 short   xtilestep,ytilestep;
@@ -272,6 +317,8 @@ static void ScalePost(void)
    while(yoffs <= yendoffs)
    {
       vbuf[yendoffs]  = col;
+      if (raystep > 1)
+         vbuf[yendoffs+1] = col;
       ywcount        -= TEXTURESIZE/2;
 
       if (ywcount <= 0)
@@ -319,7 +366,7 @@ static void HitVertWall (void)
       if((pixx&3) && texture == lasttexture)
       {
          postx = pixx;
-         wallheight[pixx] = wallheight[pixx-1];
+         wallheight[pixx] = wallheight[pixx-raystep];
          return;
       }
 
@@ -389,7 +436,7 @@ static void HitHorizWall(void)
       if((pixx&3) && texture == lasttexture)
       {
          postx=pixx;
-         wallheight[pixx] = wallheight[pixx-1];
+         wallheight[pixx] = wallheight[pixx-raystep];
          return;
       }
       wallheight[pixx]    = CalcHeight();
@@ -446,7 +493,7 @@ static void HitHorizDoor (void)
       if((pixx&3) && texture == lasttexture)
       {
          postx            = pixx;
-         wallheight[pixx] = wallheight[pixx-1];
+         wallheight[pixx] = wallheight[pixx-raystep];
          return;
       }
       wallheight[pixx]  = CalcHeight();
@@ -507,7 +554,7 @@ static void HitVertDoor (void)
       if((pixx&3) && texture == lasttexture)
       {
          postx            = pixx;
-         wallheight[pixx] = wallheight[pixx-1];
+         wallheight[pixx] = wallheight[pixx-raystep];
          return;
       }
 
@@ -550,7 +597,7 @@ static void HitVertDoor (void)
 
 //==========================================================================
 
-byte vgaCeiling[]=
+static const byte vgaCeiling[]=
 {
 #ifndef SPEAR
  0x1d,0x1d,0x1d,0x1d,0x1d,0x1d,0x1d,0x1d,0x1d,0xbf,
@@ -744,7 +791,7 @@ static void SimpleScaleShape (int xcenter, int shapenum, unsigned height)
    unsigned scale     = height >> 1;
    unsigned pixheight = scale * SPRITESCALEFACTOR;
    int actx           = xcenter - scale;
-   int upperedge      = viewheight / 2 - scale;
+   int upperedge      = viewheight - 2 * scale;   /* rests on the bottom */
    word *cmdptr       = shape->dataofs;
 
    for(i = leftpix, pixcnt = i * pixheight, rpix = (pixcnt >> 6) + actx;
@@ -985,7 +1032,7 @@ static void DrawPlayerWeapon (void)
     {
 #ifndef APOGEE_1_0
         if (player->state == &s_deathcam && (GetTimeCount()&32) )
-            SimpleScaleShape(viewwidth/2,SPR_DEATHCAM,viewheight+1);
+            SimpleScaleShape(viewwidth/2,SPR_DEATHCAM,weaponheight);
 #endif
         return;
     }
@@ -994,11 +1041,11 @@ static void DrawPlayerWeapon (void)
     if (gamestate.weapon != -1)
     {
         shapenum = weaponscale[gamestate.weapon]+gamestate.weaponframe;
-        SimpleScaleShape(viewwidth/2,shapenum,viewheight+1);
+        SimpleScaleShape(viewwidth/2,shapenum,weaponheight);
     }
 
     if (demorecord || demoplayback)
-        SimpleScaleShape(viewwidth/2,SPR_DEMO,viewheight+1);
+        SimpleScaleShape(viewwidth/2,SPR_DEMO,weaponheight);
 }
 
 
@@ -1018,6 +1065,7 @@ static void DrawPlayerWeapon (void)
 void CalcTics (void)
 {
    uint32_t curtime;
+   word     subtic;
 
    /* calculate tics since last refresh for adaptive timing */
    if (lasttimecount > (int32_t) GetTimeCount())
@@ -1025,76 +1073,330 @@ void CalcTics (void)
 
    curtime = LR_GetTicks();
    tics = (curtime * 7) / 100 - lasttimecount;
+   subtic = (curtime * 7) % 100 * 65536 / 100;
 
    if(!tics)
    {
       /* wait until end of current tic */
-      rarch_sleep(((lasttimecount + 1) * 100) / 7 - curtime);
+      LR_Delay(((lasttimecount + 1) * 100) / 7 - curtime);
       tics = 1;
+      subtic = 0;
    }
 
    lasttimecount += tics;
 
+   /* sounds of this frame start where it is in game time */
+   SD_SetEventTime(lasttimecount, subtic);
+
    if (tics > MAXTICS)
       tics = MAXTICS;
 }
 
-static void AsmRefresh(void)
+typedef struct
 {
    int32_t xstep,ystep;
+   int32_t xintercept,yintercept;
+   int32_t xtile,ytile;
+   int32_t xtilestep,ytilestep;
+} raystart_t;
+
+/*
+========================
+=
+= StartRay
+=
+= Sets up the ray of column pix up to its first tile crossings
+=
+========================
+*/
+
+static inline void StartRay(int pix, raystart_t *ray)
+{
    longword xpartial,ypartial;
-   boolean playerInPushwallBackTile = tilemap[focaltx][focalty] == 64;
+   short angl = midangle+pixelangle[pix];
+   if(angl < 0)
+      angl += FINEANGLES;
+   if(angl >= 3600)
+      angl -= FINEANGLES;
 
-   for(pixx = 0; pixx < viewwidth; pixx++)
+   if(angl < 900)
+   {
+      ray->xtilestep=1;
+      ray->ytilestep=-1;
+      ray->xstep=finetangent[900-1-angl];
+      ray->ystep=-finetangent[angl];
+      xpartial=xpartialup;
+      ypartial=ypartialdown;
+   }
+   else if(angl < 1800)
+   {
+      ray->xtilestep=-1;
+      ray->ytilestep=-1;
+      ray->xstep=-finetangent[angl-900];
+      ray->ystep=-finetangent[1800-1-angl];
+      xpartial=xpartialdown;
+      ypartial=ypartialdown;
+   }
+   else if(angl < 2700)
+   {
+      ray->xtilestep= -1;
+      ray->ytilestep=  1;
+      ray->xstep    = -finetangent[2700-1-angl];
+      ray->ystep    = finetangent[angl-1800];
+      xpartial      = xpartialdown;
+      ypartial      = ypartialup;
+   }
+   else
    {
-      short angl = midangle+pixelangle[pixx];
-      if(angl < 0)
-         angl += FINEANGLES;
-      if(angl >= 3600)
-         angl -= FINEANGLES;
+      ray->xtilestep= 1;
+      ray->ytilestep= 1;
+      ray->xstep    = finetangent[angl-2700];
+      ray->ystep    = finetangent[3600-1-angl];
+      xpartial      = xpartialup;
+      ypartial      = ypartialup;
+   }
+
+   ray->yintercept = FixedMul(ray->ystep,xpartial)+viewy;
+   ray->xtile      = focaltx+ray->xtilestep;
+   ray->xintercept = FixedMul(ray->xstep,ypartial)+viewx;
+   ray->ytile      = focalty+ray->ytilestep;
+}
 
-      if(angl < 900)
+#ifdef RAYPACKET
+
+typedef union
+{
+   rayvec  v;
+   int32_t i[RAYLANES];
+} raylanes_t;
+
+static raylanes_t packxtile,packytile,packxint,packyint;
+static raylanes_t packxstep,packystep,packxtilestep,packytilestep;
+static raylanes_t packhoriz;
+
+/*
+========================
+=
+= TracePacket
+=
+= Starts the rays of up to RAYLANES columns from pix on and steps them in
+= lockstep through empty tiles, marking those in spotvis. Every ray is left
+= in front of its first solid tile or the map edge, with packhoriz telling
+= whether that is a horizontal crossing, for AsmRefresh to finish in column
+= order. The crossing order is the scalar loops' own. Returns the rays
+= started.
+=
+========================
+*/
+
+static int TracePacket(int pix)
+{
+   raystart_t ray;
+   raylanes_t act,spot;
+   rayvec xtile_,ytile_,xint,yint,xstep,ystep,xts,yts;
+   rayvec ones = V_DUP(-1),phase = V_ZERO,active,horiz;
+   int lanes,i,moving;
+
+   memset(&act,0,sizeof(act));
+   for(lanes = 0; lanes < RAYLANES; lanes++, pix += raystep)
+   {
+      if(pix < viewwidth)
       {
-         xtilestep=1;
-         ytilestep=-1;
-         xstep=finetangent[900-1-angl];
-         ystep=-finetangent[angl];
-         xpartial=xpartialup;
-         ypartial=ypartialdown;
+         StartRay(pix,&ray);
+         act.i[lanes] = -1;
       }
-      else if(angl < 1800)
+      else
+         memset(&ray,0,sizeof(ray));
+      packxtile.i[lanes] = ray.xtile;
+      packytile.i[lanes] = ray.ytile;
+      packxint.i[lanes] = ray.xintercept;
+      packyint.i[lanes] = ray.yintercept;
+      packxstep.i[lanes] = ray.xstep;
+      packystep.i[lanes] = ray.ystep;
+      packxtilestep.i[lanes] = ray.xtilestep;
+      packytilestep.i[lanes] = ray.ytilestep;
+   }
+
+   xtile_ = packxtile.v;
+   ytile_ = packytile.v;
+   xint = packxint.v;
+   yint = packyint.v;
+   xstep = packxstep.v;
+   ystep = packystep.v;
+   xts = packxtilestep.v;
+   yts = packytilestep.v;
+
+   do
+   {
+      /* past the row (column) it is heading for? sign flipped by the step */
+      rayvec dy = V_SUB(V_SRA(yint,16),ytile_);
+      rayvec dx = V_SUB(V_SRA(xint,16),xtile_);
+      rayvec ys = V_SRA(yts,31);
+      rayvec xs = V_SRA(xts,31);
+      rayvec behindy = V_SRA(V_SUB(V_XOR(dy,ys),ys),31);
+      rayvec behindx = V_SRA(V_SUB(V_XOR(dx,xs),xs),31);
+
+      /* the vertical loop turns horizontal once y is reached, and back */
+      horiz = V_SEL(phase,behindx,V_XOR(behindy,ones));
+
+      /* rays still inside the map, with spots masked so all can load */
+      act.v = V_AND(act.v,V_ISZERO(V_SEL(horiz,
+            V_OR(V_SRL(xint,16+mapshift),V_SRL(ytile_,mapshift)),
+            V_OR(V_SRL(yint,16+mapshift),V_SRL(xtile_,mapshift)))));
+      spot.v = V_AND(V_DUP(maparea-1),V_SEL(horiz,
+            V_ADD(V_SHL(V_SRL(xint,16),mapshift),ytile_),
+            V_ADD(V_SHL(xtile_,mapshift),V_SRL(yint,16))));
+
+      moving = 0;
+      for(i = 0; i < RAYLANES; i++)
       {
-         xtilestep=-1;
-         ytilestep=-1;
-         xstep=-finetangent[angl-900];
-         ystep=-finetangent[1800-1-angl];
-         xpartial=xpartialdown;
-         ypartial=ypartialdown;
+         int pass = act.i[i] & !((byte *)tilemap)[spot.i[i]];
+         act.i[i] = -pass;
+         ((byte *)spotvis)[spot.i[i]] |= pass;
+         moving |= pass;
       }
-      else if(angl < 2700)
+      if(!moving)
+         break;
+
+      active = act.v;
+      xtile_ = V_ADD(xtile_,V_AND(xts,V_ANDNOT(active,horiz)));
+      yint = V_ADD(yint,V_AND(ystep,V_ANDNOT(active,horiz)));
+      ytile_ = V_ADD(ytile_,V_AND(yts,V_AND(active,horiz)));
+      xint = V_ADD(xint,V_AND(xstep,V_AND(active,horiz)));
+      phase = V_SEL(active,horiz,phase);
+   } while(1);
+
+   /* stopped rays kept their state, so the last crossing test holds */
+   packxtile.v = xtile_;
+   packytile.v = ytile_;
+   packxint.v = xint;
+   packyint.v = yint;
+   packhoriz.v = horiz;
+
+   return lanes;
+}
+
+#endif
+
+/*
+========================
+=
+= SkipEmpty
+=
+= Every tile closer than its tiledist to the one at spot is empty, so a
+= ray in that tile crosses them without AsmRefresh's hit tests. The
+= crossings are made in the same order and with the same arithmetic as
+= AsmRefresh's loops, only marking spotvis, up to the first one that
+= would leave those tiles. Returns true if AsmRefresh goes on in its
+= horizontal loop.
+=
+========================
+*/
+
+static boolean SkipEmpty(word spot, int32_t xstep, int32_t ystep, boolean horiz)
+{
+   int reach = ((byte *)tiledist)[spot]-1;
+   int x0 = (spot>>mapshift)-reach;
+   int y0 = (spot&(MAPSIZE-1))-reach;
+   unsigned span = reach*2;
+   /* kept in locals, the spotvis stores would make the globals reload */
+   int xt = xtile,yt = ytile,xts = xtilestep,yts = ytilestep;
+   int32_t xi = xintercept,yi = yintercept;
+   boolean next;
+   int x,y;
+
+   do
+   {
+      if(horiz)
+         next = !(xts==-1 && (xi>>16)<=xt || xts==1 && (xi>>16)>=xt);
+      else
+         next = yts==-1 && (yi>>16)<=yt || yts==1 && (yi>>16)>=yt;
+      if(next)
       {
-         xtilestep= -1;
-         ytilestep=  1;
-         xstep    = -finetangent[2700-1-angl];
-         ystep    = finetangent[angl-1800];
-         xpartial = xpartialdown;
-         ypartial = ypartialup;
+         x = xi>>16;
+         if((unsigned)(x-x0)>span || (unsigned)(yt-y0)>span)
+            break;
+         spotvis[x][yt]=1;
+         yt+=yts;
+         xi+=xstep;
       }
-      else if(angl < 3600)
+      else
       {
-         xtilestep= 1;
-         ytilestep= 1;
-         xstep    = finetangent[angl-2700];
-         ystep    = finetangent[3600-1-angl];
-         xpartial = xpartialup;
-         ypartial = ypartialup;
+         y = yi>>16;
+         if((unsigned)(xt-x0)>span || (unsigned)(y-y0)>span)
+            break;
+         spotvis[xt][y]=1;
+         xt+=xts;
+         yi+=ystep;
       }
+      horiz = next;
+   } while(1);
+
+   xtile = (short) xt;
+   ytile = (short) yt;
+   xintercept = xi;
+   yintercept = yi;
+   return horiz;
+}
+
+/*
+========================
+=
+= AsmRefresh
+=
+= Traces one ray per column. With SIMDRAYS the empty stretch of every ray
+= is walked RAYLANES columns at a time by TracePacket first; the tile
+= loads stay scalar, so the walk is still bound by them. Wherever a ray
+= passes a tile with open space around it, SkipEmpty crosses that space.
+=
+========================
+*/
+
+static void AsmRefresh(void)
+{
+   int32_t xstep,ystep;
+   raystart_t ray;
+   boolean playerInPushwallBackTile = tilemap[focaltx][focalty] == 64;
+#ifdef RAYPACKET
+   int lane = 0,lanes = 0;
+#endif
 
-      yintercept  = FixedMul(ystep,xpartial)+viewy;
-      xtile       = focaltx+xtilestep;
+   for(pixx = 0; pixx < viewwidth; pixx += raystep)
+   {
+#ifdef RAYPACKET
+      if(!playerInPushwallBackTile)
+      {
+         if(lane == lanes)
+         {
+            lanes = TracePacket(pixx);
+            lane = 0;
+         }
+         xtile      = (short) packxtile.i[lane];
+         ytile      = (short) packytile.i[lane];
+         xintercept = packxint.i[lane];
+         yintercept = packyint.i[lane];
+         xstep      = packxstep.i[lane];
+         ystep      = packystep.i[lane];
+         xtilestep  = (short) packxtilestep.i[lane];
+         ytilestep  = (short) packytilestep.i[lane];
+         xspot      = (word)((xtile<<mapshift)+((uint32_t)yintercept>>16));
+         yspot      = (word)((((uint32_t)xintercept>>16)<<mapshift)+ytile);
+         texdelta   = 0;
+         if(packhoriz.i[lane++])
+            goto horizentry;
+         goto vertentry;
+      }
+#endif
+      StartRay(pixx,&ray);
+      xtilestep   = (short) ray.xtilestep;
+      ytilestep   = (short) ray.ytilestep;
+      xstep       = ray.xstep;
+      ystep       = ray.ystep;
+      yintercept  = ray.yintercept;
+      xtile       = (short) ray.xtile;
       xspot       = (word)((xtile<<mapshift)+((uint32_t)yintercept>>16));
-      xintercept  = FixedMul(xstep,ypartial)+viewx;
-      ytile       = focalty+ytilestep;
+      xintercept  = ray.xintercept;
+      ytile       = (short) ray.ytile;
       yspot       = (word)((((uint32_t)xintercept>>16)<<mapshift)+ytile);
       texdelta    = 0;
 
@@ -1143,6 +1445,7 @@ static void AsmRefresh(void)
 
       do
       {
+verttop:
          if(ytilestep==-1 && (yintercept>>16)<=ytile)
             goto horizentry;
          if(ytilestep==1 && (yintercept>>16)>=ytile)
@@ -1301,12 +1604,22 @@ passvert:
          *((byte *)spotvis+xspot)=1;
          xtile+=xtilestep;
          yintercept+=ystep;
+         if(((byte *)tiledist)[xspot]>1)
+         {
+            boolean horiz = SkipEmpty(xspot,xstep,ystep,false);
+            xspot=(word)((xtile<<mapshift)+((uint32_t)yintercept>>16));
+            yspot=(word)((((uint32_t)xintercept>>16)<<mapshift)+ytile);
+            if(horiz)
+               goto horiztop;
+            continue;
+         }
          xspot=(word)((xtile<<mapshift)+((uint32_t)yintercept>>16));
       }while(1);
       continue;
 
       do
       {
+horiztop:
          if(xtilestep==-1 && (xintercept>>16)<=xtile)
             goto vertentry;
          if(xtilestep==1 && (xintercept>>16)>=xtile)
@@ -1461,6 +1774,15 @@ passhoriz:
          *((byte *)spotvis+yspot)=1;
          ytile+=ytilestep;
          xintercept+=xstep;
+         if(((byte *)tiledist)[yspot]>1)
+         {
+            boolean horiz = SkipEmpty(yspot,xstep,ystep,true);
+            xspot=(word)((xtile<<mapshift)+((uint32_t)yintercept>>16));
+            yspot=(word)((((uint32_t)xintercept>>16)<<mapshift)+ytile);
+            if(!horiz)
+               goto verttop;
+            continue;
+         }
          yspot=(word)((((uint32_t)xintercept>>16)<<mapshift)+ytile);
       }
       while(1);
@@ -1486,6 +1808,15 @@ static void WallRefresh(void)
    lastside = -1;                  /* the first pixel is on a new wall */
    AsmRefresh ();
    ScalePost ();                   /* no more optimization on last post */
+
+   if (raystep > 1)
+   {
+      int x;
+
+      /* the posts were drawn two wide, give the sprites both heights */
+      for (x = 1; x < viewwidth; x += 2)
+         wallheight[x] = wallheight[x-1];
+   }
 }
 
 static void CalcViewVariables(void)
@@ -1524,6 +1855,39 @@ static void CalcViewVariables(void)
 ========================
 */
 
+/*
+========================
+=
+= DrawAudioStats
+=
+= Mixer load of the last callback, the peak and the underruns so far
+=
+========================
+*/
+
+static void DrawAudioStats (void)
+{
+   audiostats_t stats;
+
+   SD_GetAudioStats(&stats);
+
+   fontnumber = 0;
+   SETFONTCOLOR(stats.underruns ? 0x2a : 0x0f, bordercol);
+   VWB_Bar(0, 0, 120, 20, bordercol);
+   PrintX = 2;
+   PrintY = 1;
+   US_Print("MIX ");
+   US_PrintUnsigned(stats.load);
+   US_Print("% PEAK ");
+   US_PrintUnsigned(stats.peakload);
+   US_Print("%\nCH ");
+   US_PrintUnsigned(stats.channels);
+   US_Print(" OPL ");
+   US_PrintUnsigned(stats.oplchips);
+   US_Print(" XRUN ");
+   US_PrintUnsigned(stats.underruns);
+}
+
 void ThreeDRefresh (void)
 {
    /* clear out the traced array */
@@ -1553,6 +1917,9 @@ void ThreeDRefresh (void)
    VL_UnlockSurface(screenBuffer);
    vbuf = NULL;
 
+   if (audiooverlay)
+      DrawAudioStats();
+
    /* show screen and time last cycle */
    if (fizzlein)
    {
@@ -1563,4 +1930,6 @@ void ThreeDRefresh (void)
    }
    else
       VW_UpdateScreen();
+
+   ST_Frame();
 }
@@ -47,6 +47,35 @@ void LoadLatchMem (void);
 =============================================================================
 */
 
+/*
+   DrawPlayBorder keeps what it paints in a few border layers, keyed by the
+   view size, the screen size and bordercol. A layer is a list of horizontal
+   runs with their pixels, so repainting a known border is one memcpy per
+   run, normally one per screen row above the status bar.
+*/
+
+#define NUMBORDERLAYERS 4
+
+typedef struct
+{
+   word        x, y, width;
+} borderrun_t;
+
+typedef struct
+{
+   boolean     status;          /* DrawStatusBorder alone, the view doesn't matter */
+   int         viewwidth, viewheight;
+   unsigned    screenwidth, screenheight;
+   byte        bordercol;
+   int         numruns;
+   borderrun_t *runs;
+   byte        *pixels;
+} borderlayer_t;
+
+static borderlayer_t borderlayers[NUMBORDERLAYERS];
+static int           nextborderlayer;
+static byte         *bordercover;       /* pixels painted while a layer is built */
+
 /*
 ==========================
 =
@@ -62,7 +91,7 @@ void LoadLatchMem (void);
 
 int leftchannel, rightchannel;
 #define ATABLEMAX 15
-byte righttable[ATABLEMAX][ATABLEMAX * 2] = {
+static const byte righttable[ATABLEMAX][ATABLEMAX * 2] = {
 { 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 7, 7, 7, 6, 0, 0, 0, 0, 0, 1, 3, 5, 8, 8, 8, 8, 8, 8, 8, 8},
 { 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 7, 7, 6, 4, 0, 0, 0, 0, 0, 2, 4, 6, 8, 8, 8, 8, 8, 8, 8, 8},
 { 8, 8, 8, 8, 8, 8, 8, 7, 7, 7, 7, 6, 6, 4, 1, 0, 0, 0, 1, 2, 4, 6, 8, 8, 8, 8, 8, 8, 8, 8},
@@ -79,7 +108,7 @@ byte righttable[ATABLEMAX][ATABLEMAX * 2] = {
 { 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8},
 { 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8}
 };
-byte lefttable[ATABLEMAX][ATABLEMAX * 2] = {
+static const byte lefttable[ATABLEMAX][ATABLEMAX * 2] = {
 { 8, 8, 8, 8, 8, 8, 8, 8, 5, 3, 1, 0, 0, 0, 0, 0, 6, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8},
 { 8, 8, 8, 8, 8, 8, 8, 8, 6, 4, 2, 0, 0, 0, 0, 0, 4, 6, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8},
 { 8, 8, 8, 8, 8, 8, 8, 8, 6, 4, 2, 1, 0, 0, 0, 1, 4, 6, 6, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8},
@@ -147,6 +176,7 @@ void PlaySoundLocGlobal(word s,fixed gx,fixed gy)
 
    SetSoundLoc(gx, gy);
    SD_PositionSound(leftchannel, rightchannel);
+   SD_SoundOrigin(gx, gy);
 
    channel = SD_PlaySound((soundnames) s);
 
@@ -571,6 +601,113 @@ static void ScanInfoPlane(void)
    }
 }
 
+/*
+==================
+=
+= BuildTileDist
+=
+= Chebyshev distance from every spot to the nearest wall, door or
+= pushwall in tilemap, with the outside of the map counting as solid.
+= Every tile closer to a spot than tiledist is empty, so a line can
+= cross that many minus one tiles without looking at them.
+=
+==================
+*/
+
+static int TileDistAt (int x, int y)
+{
+   if (x<0 || y<0 || x>=mapwidth || y>=mapheight)
+      return 0;
+   return tiledist[x][y];
+}
+
+void BuildTileDist (void)
+{
+   int x,y,d,n;
+
+   for (x=0;x<mapwidth;x++)
+   {
+      for (y=0;y<mapheight;y++)
+      {
+         if (tilemap[x][y])
+         {
+            tiledist[x][y] = 0;
+            continue;
+         }
+         d = TileDistAt(x-1,y-1);
+         if ((n = TileDistAt(x-1,y)) < d) d = n;
+         if ((n = TileDistAt(x-1,y+1)) < d) d = n;
+         if ((n = TileDistAt(x,y-1)) < d) d = n;
+         tiledist[x][y] = d+1;
+      }
+   }
+
+   for (x=mapwidth-1;x>=0;x--)
+   {
+      for (y=mapheight-1;y>=0;y--)
+      {
+         d = tiledist[x][y]-1;
+         if (d < 0)
+            continue;
+         if ((n = TileDistAt(x+1,y+1)) < d) d = n;
+         if ((n = TileDistAt(x+1,y)) < d) d = n;
+         if ((n = TileDistAt(x+1,y-1)) < d) d = n;
+         if ((n = TileDistAt(x,y+1)) < d) d = n;
+         tiledist[x][y] = d+1;
+      }
+   }
+}
+
+/*
+==================
+=
+= TileChanged
+=
+= Keeps tiledist in step with a tilemap change. A new wall brings spots
+= closer ring by ring around it, and stops at the first ring where
+= nothing changed: a spot it comes closer to has a neighbour one ring in
+= that it comes closer to as well. A tile that opens up (a pushwall
+= moving on) leaves the field an underestimate, which is still safe to
+= skip by, until MovePWalls rebuilds it when the pushwall stops.
+=
+==================
+*/
+
+static boolean LowerTileDist (int x, int y, int d)
+{
+   if (x<0 || y<0 || x>=mapwidth || y>=mapheight || d>=tiledist[x][y])
+      return false;
+   tiledist[x][y] = d;
+   return true;
+}
+
+void TileChanged (int tilex, int tiley)
+{
+   int i,d;
+   boolean changed;
+
+   if (!tilemap[tilex][tiley])
+      return;
+
+   tiledist[tilex][tiley] = 0;
+   for (d=1;;d++)
+   {
+      changed = false;
+      for (i=-d;i<=d;i++)
+      {
+         changed |= LowerTileDist(tilex+i,tiley-d,d);
+         changed |= LowerTileDist(tilex+i,tiley+d,d);
+      }
+      for (i=-d+1;i<d;i++)
+      {
+         changed |= LowerTileDist(tilex-d,tiley+i,d);
+         changed |= LowerTileDist(tilex+d,tiley+i,d);
+      }
+      if (!changed)
+         break;
+   }
+}
+
 /*
 ==================
 =
@@ -604,9 +741,13 @@ void SetupGameLevel (void)
    else
       US_InitRndT (true);
 
+   /* start a new working set */
+   MM_NewLevel ();
+
    /* load the level */
    CA_CacheMap (gamestate.mapon+10*gamestate.episode);
    mapon-=gamestate.episode*10;
+   ST_LoadPhase ("cachemap");
 
    /* copy the wall data to a data segment array */
    memset (tilemap,0,sizeof(tilemap));
@@ -633,6 +774,8 @@ void SetupGameLevel (void)
       }
    }
 
+   ST_LoadPhase ("tilemap");
+
    /* spawn doors */
    InitActorList (); /* start spawning things with a clean slate */
    InitDoorList ();
@@ -670,8 +813,11 @@ void SetupGameLevel (void)
       }
    }
 
+   ST_LoadPhase ("doors");
+
    /* spawn actors */
    ScanInfoPlane ();
+   ST_LoadPhase ("infoplane");     /* includes InitAreas from SpawnPlayer */
 
    /* take out the ambush markers */
    map = mapsegs[0];
@@ -701,11 +847,244 @@ void SetupGameLevel (void)
       }
    }
 
+   ST_LoadPhase ("ambush");
+
+   BuildTileDist ();
+   ST_LoadPhase ("tiledist");
+
    /* have the caching manager load and purge stuff 
     * to make sure all marks are in memory. */
    CA_LoadAllSounds ();
+   ST_LoadPhase ("sounds");
+
+   /* touch the wall and door textures so they are
+    * resident and pinned as the level's working set */
+   for (y=0;y<mapheight;y++)
+   {
+      for (x=0;x<mapwidth;x++)
+      {
+         tile = tilemap[x][y];
+         if (tile && !(tile & 0x80) && tile < MAXWALLTILES)
+         {
+            PM_GetTexture (horizwall[tile]);
+            PM_GetTexture (vertwall[tile]);
+         }
+      }
+   }
+
+   if (doornum)
+   {
+      for (x=0;x<8;x++)
+         PM_GetTexture (PMSpriteStart-8+x);    // DOORWALL pages
+   }
+   ST_LoadPhase ("textures");
+}
+
+/*
+===================
+=
+= BorderBar
+=
+= VWB_BarScaledCoord that also marks the painted area while a border
+= layer is being built
+=
+===================
+*/
+
+static void BorderBar (int scx, int scy, int scwidth, int scheight, int color)
+{
+   int y;
+
+   VWB_BarScaledCoord (scx, scy, scwidth, scheight, color);
+
+   if (bordercover)
+   {
+      for (y = scy; y < scy + scheight; y++)
+         memset (bordercover + y * screenWidth + scx, 1, scwidth);
+   }
+}
+
+
+/*
+===================
+=
+= FindBorderLayer
+=
+===================
+*/
+
+static borderlayer_t *FindBorderLayer (boolean status, byte color)
+{
+   int i;
+
+   for (i = 0; i < NUMBORDERLAYERS; i++)
+   {
+      borderlayer_t *layer = &borderlayers[i];
+
+      if (layer->pixels && layer->status == status && layer->bordercol == color
+            && layer->screenwidth == screenWidth && layer->screenheight == screenHeight
+            && (status || (layer->viewwidth == viewwidth && layer->viewheight == viewheight)))
+         return layer;
+   }
+
+   return NULL;
+}
+
+
+/*
+===================
+=
+= BeginBorderLayer
+=
+= Starts recording what BorderBar paints, for SaveBorderLayer
+=
+===================
+*/
+
+static void BeginBorderLayer (void)
+{
+   bordercover = (byte *) calloc (screenWidth * screenHeight, 1);
+   CHECKMALLOCRESULT(bordercover);
 }
 
+
+/*
+===================
+=
+= SaveBorderLayer
+=
+= Turns the area marked in bordercover into runs and copies their pixels
+= from the screen into the next free (or oldest) layer, then stops the
+= recording
+=
+===================
+*/
+
+static void SaveBorderLayer (boolean status, byte color)
+{
+   borderlayer_t *layer = &borderlayers[nextborderlayer];
+   byte     *vbuf, *dest;
+   unsigned  x, y, start;
+   int       numruns = 0;
+   int32_t   numpixels = 0;
+
+   nextborderlayer = (nextborderlayer + 1) % NUMBORDERLAYERS;
+
+   free (layer->runs);
+   free (layer->pixels);
+   memset (layer, 0, sizeof(*layer));
+
+   /* count runs and pixels */
+   for (y = 0; y < screenHeight; y++)
+   {
+      byte *cover = bordercover + y * screenWidth;
+
+      for (x = 0; x < screenWidth; )
+      {
+         if (!cover[x++])
+            continue;
+         for (start = x - 1; x < screenWidth && cover[x]; x++);
+         numruns++;
+         numpixels += x - start;
+      }
+   }
+
+   if (!numruns)
+   {
+      free (bordercover);
+      bordercover = NULL;
+      return;
+   }
+
+   layer->runs   = (borderrun_t *) malloc (numruns * sizeof(borderrun_t));
+   CHECKMALLOCRESULT(layer->runs);
+   layer->pixels = (byte *) malloc (numpixels);
+   CHECKMALLOCRESULT(layer->pixels);
+
+   layer->viewwidth    = viewwidth;
+   layer->viewheight   = viewheight;
+   layer->screenwidth  = screenWidth;
+   layer->screenheight = screenHeight;
+   layer->bordercol    = color;
+   layer->status       = status;
+
+   vbuf = VL_LockSurface (screenBuffer);
+   dest = layer->pixels;
+
+   for (y = 0; y < screenHeight; y++)
+   {
+      byte *cover = bordercover + y * screenWidth;
+
+      for (x = 0; x < screenWidth; )
+      {
+         borderrun_t *run;
+
+         if (!cover[x++])
+            continue;
+         for (start = x - 1; x < screenWidth && cover[x]; x++);
+
+         run        = &layer->runs[layer->numruns++];
+         run->x     = start;
+         run->y     = y;
+         run->width = x - start;
+
+         memcpy (dest, vbuf + y * bufferPitch + start, run->width);
+         dest += run->width;
+      }
+   }
+
+   VL_UnlockSurface (screenBuffer);
+
+   free (bordercover);
+   bordercover = NULL;
+}
+
+
+/*
+===================
+=
+= DrawBorderLayer
+=
+= With sidesonly the view window itself is left alone
+=
+===================
+*/
+
+static void DrawBorderLayer (borderlayer_t *layer, boolean sidesonly)
+{
+   byte *vbuf = VL_LockSurface (screenBuffer);
+   byte *src  = layer->pixels;
+   int   xl   = screenWidth/2-viewwidth/2;
+   int   xh   = xl + viewwidth;
+   int   yl   = (screenHeight-scaleFactor*STATUSLINES-viewheight)/2;
+   int   yh   = yl + viewheight;
+   int   i;
+
+   for (i = 0; i < layer->numruns; i++)
+   {
+      borderrun_t *run  = &layer->runs[i];
+      byte        *dest = vbuf + run->y * bufferPitch + run->x;
+      int          x    = run->x;
+      int          xend = run->x + run->width;
+
+      if (sidesonly && run->y >= yl && run->y < yh && x < xh && xend > xl)
+      {
+         /* copy what lies left and right of the view */
+         if (x < xl)
+            memcpy (dest, src, xl - x);
+         if (xend > xh)
+            memcpy (dest + xh - x, src + xh - x, xend - xh);
+      }
+      else
+         memcpy (dest, src, run->width);
+
+      src += run->width;
+   }
+
+   VL_UnlockSurface (screenBuffer);
+}
+
+
 /*
 ===================
 =
@@ -718,10 +1097,18 @@ void SetupGameLevel (void)
 void DrawPlayBorderSides(void)
 {
    int sw, sh, vw, vh, px, h, xl, yl;
+   borderlayer_t *layer;
 
    if(viewsize == 21)
       return;
 
+   layer = FindBorderLayer (false, bordercol);
+   if (layer)
+   {
+      DrawBorderLayer (layer, true);
+      return;
+   }
+
    sw = screenWidth;
    sh = screenHeight;
    vw = viewwidth;
@@ -764,31 +1151,31 @@ void DrawPlayBorderSides(void)
 /*
 ===================
 =
-= DrawStatusBorder
+= BuildStatusBorder
 =
 ===================
 */
 
-void DrawStatusBorder (byte color)
+static void BuildStatusBorder (byte color)
 {
    int statusborderw = (screenWidth-scaleFactor*320)/2;
 
-   VWB_BarScaledCoord (0,0,screenWidth,screenHeight-scaleFactor*(STATUSLINES-3),color);
-   VWB_BarScaledCoord (0,screenHeight-scaleFactor*(STATUSLINES-3),
+   BorderBar (0,0,screenWidth,screenHeight-scaleFactor*(STATUSLINES-3),color);
+   BorderBar (0,screenHeight-scaleFactor*(STATUSLINES-3),
          statusborderw+scaleFactor*8,scaleFactor*(STATUSLINES-4),color);
-   VWB_BarScaledCoord (0,screenHeight-scaleFactor*2,screenWidth,scaleFactor*2,color);
-   VWB_BarScaledCoord (screenWidth-statusborderw-scaleFactor*8, screenHeight-scaleFactor*(STATUSLINES-3),
+   BorderBar (0,screenHeight-scaleFactor*2,screenWidth,scaleFactor*2,color);
+   BorderBar (screenWidth-statusborderw-scaleFactor*8, screenHeight-scaleFactor*(STATUSLINES-3),
          statusborderw+scaleFactor*8,scaleFactor*(STATUSLINES-4),color);
 
-   VWB_BarScaledCoord (statusborderw+scaleFactor*9, screenHeight-scaleFactor*3,
+   BorderBar (statusborderw+scaleFactor*9, screenHeight-scaleFactor*3,
          scaleFactor*97, scaleFactor*1, color-1);
-   VWB_BarScaledCoord (statusborderw+scaleFactor*106, screenHeight-scaleFactor*3,
+   BorderBar (statusborderw+scaleFactor*106, screenHeight-scaleFactor*3,
          scaleFactor*161, scaleFactor*1, color-2);
-   VWB_BarScaledCoord (statusborderw+scaleFactor*267, screenHeight-scaleFactor*3,
+   BorderBar (statusborderw+scaleFactor*267, screenHeight-scaleFactor*3,
          scaleFactor*44, scaleFactor*1, color-3);
-   VWB_BarScaledCoord (screenWidth-statusborderw-scaleFactor*9, screenHeight-scaleFactor*(STATUSLINES-4),
+   BorderBar (screenWidth-statusborderw-scaleFactor*9, screenHeight-scaleFactor*(STATUSLINES-4),
          scaleFactor*1, scaleFactor*20, color-2);
-   VWB_BarScaledCoord (screenWidth-statusborderw-scaleFactor*9, screenHeight-scaleFactor*(STATUSLINES/2-4),
+   BorderBar (screenWidth-statusborderw-scaleFactor*9, screenHeight-scaleFactor*(STATUSLINES/2-4),
          scaleFactor*1, scaleFactor*14, color-3);
 }
 
@@ -796,53 +1183,105 @@ void DrawStatusBorder (byte color)
 /*
 ===================
 =
-= DrawPlayBorder
+= DrawStatusBorder
+=
+= Paints the cached layer for this color, building it on first use
 =
 ===================
 */
 
-void DrawPlayBorder (void)
+void DrawStatusBorder (byte color)
+{
+   borderlayer_t *layer = FindBorderLayer (true, color);
+
+   if (layer)
+   {
+      DrawBorderLayer (layer, false);
+      return;
+   }
+
+   BeginBorderLayer ();
+   BuildStatusBorder (color);
+   SaveBorderLayer (true, color);
+}
+
+
+/*
+===================
+=
+= BuildPlayBorder
+=
+===================
+*/
+
+static void BuildPlayBorder (void)
 {
    int xl, yl;
    const int px = scaleFactor; /* size of one "pixel" */
 
    if (bordercol != VIEWCOLOR)
-      DrawStatusBorder(bordercol);
+      BuildStatusBorder(bordercol);
    else
    {
       const int statusborderw = (screenWidth-px*320)/2;
-      VWB_BarScaledCoord (0, screenHeight-px*STATUSLINES,
+      BorderBar (0, screenHeight-px*STATUSLINES,
             statusborderw+px*8, px*STATUSLINES, bordercol);
-      VWB_BarScaledCoord (screenWidth-statusborderw-px*8, screenHeight-px*STATUSLINES,
+      BorderBar (screenWidth-statusborderw-px*8, screenHeight-px*STATUSLINES,
             statusborderw+px*8, px*STATUSLINES, bordercol);
    }
 
    if((unsigned) viewheight == screenHeight)
       return;
 
-   VWB_BarScaledCoord (0,0,screenWidth,screenHeight-px*STATUSLINES,bordercol);
+   BorderBar (0,0,screenWidth,screenHeight-px*STATUSLINES,bordercol);
 
    xl = screenWidth/2-viewwidth/2;
    yl = (screenHeight-px*STATUSLINES-viewheight)/2;
-   VWB_BarScaledCoord (xl,yl,viewwidth,viewheight,0);
+   BorderBar (xl,yl,viewwidth,viewheight,0);
 
    if(xl != 0)
    {
       /* Paint game view border lines */
-      VWB_BarScaledCoord(xl-px, yl-px, viewwidth+px, px, 0);                      // upper border
-      VWB_BarScaledCoord(xl, yl+viewheight, viewwidth+px, px, bordercol-2);       // lower border
-      VWB_BarScaledCoord(xl-px, yl-px, px, viewheight+px, 0);                     // left border
-      VWB_BarScaledCoord(xl+viewwidth, yl-px, px, viewheight+2*px, bordercol-2);  // right border
-      VWB_BarScaledCoord(xl-px, yl+viewheight, px, px, bordercol-3);              // lower left highlight
+      BorderBar(xl-px, yl-px, viewwidth+px, px, 0);                      // upper border
+      BorderBar(xl, yl+viewheight, viewwidth+px, px, bordercol-2);       // lower border
+      BorderBar(xl-px, yl-px, px, viewheight+px, 0);                     // left border
+      BorderBar(xl+viewwidth, yl-px, px, viewheight+2*px, bordercol-2);  // right border
+      BorderBar(xl-px, yl+viewheight, px, px, bordercol-3);              // lower left highlight
    }
    else
    {
       /* Just paint a lower border line */
-      VWB_BarScaledCoord(0, yl+viewheight, viewwidth, px, bordercol-2);       // lower border
+      BorderBar(0, yl+viewheight, viewwidth, px, bordercol-2);       // lower border
    }
 }
 
 
+/*
+===================
+=
+= DrawPlayBorder
+=
+= Paints the cached layer for this view, building it on first use
+=
+===================
+*/
+
+void DrawPlayBorder (void)
+{
+   borderlayer_t *layer = FindBorderLayer (false, bordercol);
+
+   if (layer)
+   {
+      DrawBorderLayer (layer, false);
+      return;
+   }
+
+   BeginBorderLayer ();
+   BuildPlayBorder ();
+   SaveBorderLayer (false, bordercol);
+}
+
+
 /*
 ===================
 =
@@ -853,7 +1292,7 @@ void DrawPlayBorder (void)
 
 void DrawPlayScreen (void)
 {
-    VWB_DrawPicScaledCoord ((screenWidth-scaleFactor*320)/2,screenHeight-scaleFactor*STATUSLINES,STATUSBARPIC);
+    StatusDrawBar ();
     DrawPlayBorder ();
 
     DrawFace ();
@@ -904,6 +1343,9 @@ void ShowActStatus(void)
    int desty    = screenHeight - (height - 4) * scaleFactor;
    VL_MemToScreenScaledCoord2(source, width, height, 9, 4, destx, desty, width - 18, height - 7);
 
+   /* the fields were painted over, so the cached cells no longer apply */
+   StatusInvalidate ();
+
    ingame = false;
    DrawFace ();
    DrawHealth ();
@@ -973,16 +1415,20 @@ void PlayDemo (int demonumber)
    demoptr++;
    lastdemoptr = demoptr-4+length;
 
+   ST_LoadBegin ("demo", gamestate.episode+1, gamestate.mapon+1);
    VW_FadeOut ();
+   ST_LoadWait ("fadeout");
 
    SETFONTCOLOR(0,15);
    DrawPlayScreen ();
+   ST_LoadPhase ("playscreen");
 
    startgame = false;
    demoplayback = true;
 
    SetupGameLevel ();
    StartMusic ();
+   ST_LoadPhase ("music");
 
    PlayLoop ();
 
@@ -998,6 +1444,176 @@ void PlayDemo (int demonumber)
    SD_StopDigitized ();
 }
 
+/*
+==================
+=
+= RenderBench
+=
+= Draws every map from fixed camera poses: the player start and floor
+= tiles spread evenly over the map, each at several angles. Each frame
+= is timed and hashed. The hashes are checked against the file at path,
+= or written to it when it doesn't exist yet, so a renderer change can
+= be shown to draw the same pixels independently of demo playback.
+=
+= The view size and the original projection are forced for the run. The
+= file starts with the data set and resolution it was made with, and a
+= file made with others is refused. renderbench-wl6.txt in the source
+= tree holds the hashes of the full WL6 data at 320x200.
+=
+= Returns the number of frames that differ
+=
+==================
+*/
+
+#define BENCHSPOTS      8       // floor tiles per map, besides the start
+#define BENCHANGLES     8       // views per spot
+#define BENCHRUNS       3       // renders per view, the fastest is kept
+#define BENCHVIEWSIZE   19      // the default view
+
+static longword BenchHash (void)
+{
+   longword hash = CA_HASHSEED;
+   byte     *src = VL_LockSurface(screenBuffer) + screenofs;
+   int      y;
+
+   for (y = 0; y < viewheight; y++, src += bufferPitch)
+      hash = CA_Hash(hash, src, viewwidth);
+
+   VL_UnlockSurface(screenBuffer);
+   return hash;
+}
+
+int RenderBench (const char *path)
+{
+   FILE     *golden, *out = NULL;
+   boolean  overlay = audiooverlay;
+   int      oldviewsize = viewsize, oldfov = param_fov;
+   int      map,spot,pose,floors,pick,x,y,run;
+   char     refext[5];
+   unsigned refwidth,refheight;
+   int      tx[BENCHSPOTS+1],ty[BENCHSPOTS+1];
+   int      refmap,refpose;
+   int      frames = 0, differ = 0;
+   longword hash,refhash,usec,best,total = 0;
+   uint32_t start;
+
+   golden = fopen (path, "r");
+   if (!golden)
+   {
+      out = fopen (path, "w");
+      if (!out)
+         Quit ("RenderBench: Can't create %s!", path);
+      fprintf (out, "# %s %ux%u\n", extension, screenWidth, screenHeight);
+   }
+   else
+   {
+      if (fscanf (golden, "# %4s %ux%u", refext, &refwidth, &refheight) != 3)
+         Quit ("RenderBench: %s is not a render bench file!", path);
+      if (strcmp (refext, extension) || refwidth != screenWidth || refheight != screenHeight)
+         Quit ("RenderBench: %s was made for %s at %ux%u, not %s at %ux%u!", path,
+               refext, refwidth, refheight, extension, screenWidth, screenHeight);
+   }
+
+   //
+   // keep presents, sounds and the overlay out of it, and the
+   // view size and field of view of the player
+   //
+   audiooverlay = false;
+   raystep = 1;
+   param_fov = 0;
+   NewViewSize (BENCHVIEWSIZE);
+   BeginSpeculativeFrame ();
+
+   NewGame (GD_HARD, 0);
+
+   for (map = 0; map < NUMMAPS; map++)
+   {
+      if (!CA_MapPresent (map))
+         continue;
+
+      gamestate.episode = map / 10;
+      gamestate.mapon = map % 10;
+      SetupGameLevel ();
+
+      //
+      // the start, then floor tiles picked at even steps in map order
+      //
+      tx[0] = player->tilex;
+      ty[0] = player->tiley;
+      spot = 1;
+
+      floors = 0;
+      for (y = 0; y < mapheight; y++)
+         for (x = 0; x < mapwidth; x++)
+            if (!tilemap[x][y] && MAPSPOT(x,y,0) >= AREATILE)
+               floors++;
+
+      pick = 0;
+      for (y = 0; y < mapheight && spot <= BENCHSPOTS; y++)
+      {
+         for (x = 0; x < mapwidth && spot <= BENCHSPOTS; x++)
+         {
+            if (tilemap[x][y] || MAPSPOT(x,y,0) < AREATILE)
+               continue;
+            if (pick++ == (spot - 1) * floors / BENCHSPOTS)
+            {
+               tx[spot] = x;
+               ty[spot] = y;
+               spot++;
+            }
+         }
+      }
+
+      for (pose = 0; pose < spot * BENCHANGLES; pose++)
+      {
+         player->tilex = tx[pose / BENCHANGLES];
+         player->tiley = ty[pose / BENCHANGLES];
+         player->x = ((int32_t)player->tilex << TILESHIFT) + TILEGLOBAL/2;
+         player->y = ((int32_t)player->tiley << TILESHIFT) + TILEGLOBAL/2;
+         player->angle = (pose % BENCHANGLES) * ANGLES / BENCHANGLES;
+
+         best = 0;
+         for (run = 0; run < BENCHRUNS; run++)
+         {
+            start = LR_GetMicroTicks ();
+            ThreeDRefresh ();
+            usec = LR_GetMicroTicks () - start;
+            if (!run || usec < best)
+               best = usec;
+         }
+         hash = BenchHash ();
+         total += best;
+         frames++;
+
+         if (out)
+            fprintf (out, "%d %d %08x\n", map, pose, hash);
+         else if (fscanf (golden, "%d %d %x", &refmap, &refpose, &refhash) != 3
+               || refmap != map || refpose != pose || refhash != hash)
+         {
+            differ++;
+            printf ("map %2d pose %3d: %08x differs\n", map, pose, hash);
+         }
+
+         printf ("map %2d pose %3d: %6u us\n", map, pose, best);
+      }
+   }
+
+   printf ("RenderBench: %d frames, %u us in all, %u us on average\n",
+         frames, total, frames ? total / frames : 0);
+
+   DropSpeculativeFrame ();
+   audiooverlay = overlay;
+   param_fov = oldfov;
+   NewViewSize (oldviewsize);
+
+   if (golden)
+      fclose (golden);
+   if (out)
+      fclose (out);
+
+   return differ;
+}
+
 /*
 ==================
 =
@@ -1299,11 +1915,13 @@ boolean restartgame = true;
 int GameLoop (void)
 {
 repeat:
+   ST_LoadBegin ("level", gamestate.episode+1, gamestate.mapon+1);
    if (restartgame)
    {
       SD_StopDigitized ();
       SETFONTCOLOR(0,15);
       VW_FadeOut();
+      ST_LoadWait ("fadeout");
       DrawPlayScreen ();
       died = false;
       restartgame = false;
@@ -1313,6 +1931,7 @@ repeat:
       gamestate.score = gamestate.oldscore;
    if(!died || viewsize != 21)
       DrawScore();
+   ST_LoadPhase ("playscreen");
 
    startgame = false;
    if (!loadedgame)
@@ -1334,6 +1953,7 @@ repeat:
    }
    else
       StartMusic ();
+   ST_LoadPhase ("music");
 
    if (!died)
       PreloadGraphics (); /* TODO: Let this do something useful! */
@@ -1344,6 +1964,7 @@ repeat:
    }
 
    DrawLevel ();
+   ST_LoadPhase ("drawlevel");
 
 #ifdef SPEAR
 startplayloop:
@@ -1363,8 +1984,10 @@ startplayloop:
       SD_StopDigitized ();
       gamestate.oldscore = gamestate.score;
       gamestate.mapon = 20;
+      ST_LoadBegin ("level", gamestate.episode+1, gamestate.mapon+1);
       SetupGameLevel ();
       StartMusic ();
+      ST_LoadPhase ("music");
       player->x = spearx;
       player->y = speary;
       player->angle = (short)spearangle;
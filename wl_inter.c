@@ -387,7 +387,7 @@ static void BJ_Breathe (void)
    static int which = 0, max = 10;
    int pics[2] = { L_GUYPIC, L_GUY2PIC };
 
-   rarch_sleep(5);
+   LR_Delay(5);
 
    if ((int32_t) GetTimeCount () - lastBreathTime > max)
    {
@@ -957,7 +957,7 @@ void PreloadGraphics (void)
    ClearSplitVWB ();           // set up for double buffering in split screen
 
    VWB_BarScaledCoord (0, 0, screenWidth, screenHeight - scaleFactor * (STATUSLINES - 1), bordercol);
-   LatchDrawPicScaledCoord ((screenWidth-scaleFactor*224)/16,
+   LatchDrawPicScaledCoord ((screenWidth-scaleFactor*224)/2,
          (screenHeight-scaleFactor*(STATUSLINES+48))/2, GETPSYCHEDPIC);
 
    WindowX = (screenWidth - scaleFactor*224)/2;
@@ -966,14 +966,17 @@ void PreloadGraphics (void)
    WindowH = scaleFactor * 48;
 
    VW_UpdateScreen ();
+   ST_LoadPhase ("preload");
    VW_FadeIn ();
 
    PreloadUpdate (10, 10);
    IN_UserInput (70);
    VW_FadeOut ();
+   ST_LoadWait ("psyched");
 
    DrawPlayBorder ();
    VW_UpdateScreen ();
+   ST_LoadPhase ("border");
 }
 
 
@@ -7,6 +7,8 @@
 #endif
 
 #include "wl_def.h"
+#include <retro_endian.h>
+#include "fmopl.h"
 
 /*
 =============================================================================
@@ -20,7 +22,9 @@
 =============================================================================
 */
 
-extern byte signon[];
+#define SIGNONTAG   0xabcd
+
+extern const word signon[];
 
 /*
 =============================================================================
@@ -70,6 +74,8 @@ short    centerx;
 int      shootdelta;           // pixels away from centerx a target can be
 fixed    scale;
 int32_t  heightnumerator;
+int      refviewwidth;         // width a 4:3 view of viewheight would have
+unsigned weaponheight;         // scaled height of the player's hands
 
 
 void    Quit (const char *error,...);
@@ -81,6 +87,18 @@ int     mouseadjustment;
 char    configdir[256] = "";
 char    configname[13] = "config.";
 
+//
+// speculative frames, see BeginSpeculativeFrame
+//
+#define SPECFILES   4
+
+boolean speculative;
+
+static boolean specconfig;
+static int     specfiles;
+static FILE   *specfile[SPECFILES];
+static char    specpath[SPECFILES][300];
+
 //
 // Command line parameter variables
 //
@@ -96,6 +114,11 @@ int     param_joystickhat = -1;
 int     param_mission = 0;
 boolean param_goodtimes = false;
 boolean param_ignorenumchunks = false;
+int     param_fov = 0;                  // 0 keeps the original projection
+char   *param_renderbench = NULL;       // file of golden frame hashes
+int     param_decodebench = 0;          // runs over the data set
+int     param_clock = LR_CLOCK_REAL;    // source of game time
+int     param_clockrate = 100;          // percent of real time
 
 /*
 =============================================================================
@@ -225,6 +248,12 @@ static void WriteConfig(void)
    int dummyJoystickPort = 0;
    word tmp = 0xfefa;
 
+   if (speculative)
+   {
+      specconfig = true;        // written once the frame is committed
+      return;
+   }
+
    if(configdir[0])
       snprintf(configpath, sizeof(configpath), "%s/%s", configdir, configname);
    else
@@ -457,6 +486,7 @@ boolean LoadTheGame(FILE *file,int x,int y)
 
    DiskFlopAnim(x,y);
    fread (tilemap,sizeof(tilemap),1,file);
+   BuildTileDist ();
    checksum = DoChecksum((byte *)tilemap,sizeof(tilemap),checksum);
 
    DiskFlopAnim(x,y);
@@ -600,6 +630,16 @@ boolean LoadTheGame(FILE *file,int x,int y)
 
 void ShutdownId (void)
 {
+    if (MMReport)
+        MM_Report ();
+    if (audiooverlay)
+        SD_ReportAudioStats ();
+    if (YM3812Verify)
+        printf("OPL: %u updates differed from the reference render\n", YM3812Mismatches);
+    if (framepolicy != FS_RENDERALL)
+        ReportFrameStats ();
+    ST_Shutdown ();
+    StatusShutdown ();
     US_Shutdown ();
     SD_Shutdown ();
     PM_Shutdown ();
@@ -609,6 +649,147 @@ void ShutdownId (void)
 }
 
 
+/*
+==========================
+=
+= BeginSpeculativeFrame
+=
+= Frontends that run ahead execute frames they may throw away. Until the
+= frame is committed or dropped nothing leaves the game: sound and music
+= calls are held in the sound manager, presents in the video layer and
+= save files in temporary files.
+=
+==========================
+*/
+
+void BeginSpeculativeFrame (void)
+{
+    speculative = true;
+}
+
+
+/*
+==========================
+=
+= CommitSpeculativeFrame
+=
+= Carries out everything the speculative frame held back
+=
+==========================
+*/
+
+void CommitSpeculativeFrame (void)
+{
+    int    i;
+    size_t len;
+    FILE  *file;
+    char   buffer[4096];
+
+    speculative = false;
+
+    for (i = 0; i < specfiles; i++)
+    {
+        rewind (specfile[i]);
+        unlink (specpath[i]);
+        file = fopen (specpath[i], "wb");
+        if (file)
+        {
+            while ((len = fread (buffer, 1, sizeof(buffer), specfile[i])) > 0)
+                fwrite (buffer, 1, len, file);
+            fclose (file);
+        }
+        fclose (specfile[i]);
+    }
+    specfiles = 0;
+
+    if (specconfig)
+    {
+        specconfig = false;
+        WriteConfig ();
+    }
+
+    SD_CommitSounds ();
+    VL_ReleasePresent (true);
+}
+
+
+/*
+==========================
+=
+= DropSpeculativeFrame
+=
+==========================
+*/
+
+void DropSpeculativeFrame (void)
+{
+    int i;
+
+    speculative = false;
+
+    for (i = 0; i < specfiles; i++)
+        fclose (specfile[i]);
+    specfiles = 0;
+    specconfig = false;
+
+    SD_DropSounds ();
+    VL_ReleasePresent (false);
+}
+
+
+/*
+==========================
+=
+= OpenSaveFile
+=
+= Replaces the file at path, or a temporary stand-in during a
+= speculative frame. Returns NULL if a speculative frame cannot hold
+= another file, the real one is never written then.
+=
+==========================
+*/
+
+FILE *OpenSaveFile (const char *path)
+{
+    FILE *file;
+    int   i;
+
+    if (speculative)
+    {
+        for (i = 0; i < specfiles && strcmp (specpath[i], path); i++)
+            ;
+        if (i == SPECFILES || !(file = tmpfile ()))
+            return NULL;
+        if (i < specfiles)
+            fclose (specfile[i]);       // saved again, the last one wins
+        else
+        {
+            snprintf (specpath[i], sizeof(specpath[0]), "%s", path);
+            specfiles++;
+        }
+        specfile[i] = file;
+        return file;
+    }
+
+    unlink (path);
+    return fopen (path, "wb");
+}
+
+
+void CloseSaveFile (FILE *file)
+{
+    int i;
+
+    for (i = 0; i < specfiles; i++)
+    {
+        if (specfile[i] == file)
+            return;             // kept open until commit
+    }
+
+    fclose (file);
+}
+
+
 /*
 ==================
 =
@@ -654,7 +835,20 @@ static void BuildTables (void)
    sintable[3 * ANGLEQUAD] = -65536;
 }
 
-/* Uses focallength */
+/*
+====================
+=
+= CalcProjection
+=
+= Uses focallength
+=
+= The projection is built for refviewwidth, the width a 4:3 view of the
+= current height would have. Any extra columns of a widescreen view widen
+= the field of view instead of stretching the picture. param_fov sets the
+= horizontal field of view of that 4:3 reference in degrees.
+=
+====================
+*/
 
 static void CalcProjection (int32_t focal)
 {
@@ -663,26 +857,42 @@ static void CalcProjection (int32_t focal)
     float   angle;
     double  tang;
     int     halfview;
+    int     refhalfview;
     double  facedist;
+    double  viewglobal;
 
     focallength = focal;
     facedist    = focal + MINDIST;
     halfview    = viewwidth/2; /* half view in pixels */
+    refhalfview = refviewwidth/2;
+
+    /* width of the projection plane at facedist */
+    if (param_fov)
+        viewglobal = 2*facedist*tan(param_fov*M_PI/360);
+    else
+        viewglobal = VIEWGLOBAL;
 
     /* calculate scale value for vertical 
      * height calculations
      * and sprite x calculations. */
-    scale       = (fixed) (halfview*facedist/(VIEWGLOBAL/2));
+    scale       = (fixed) (refhalfview*facedist/(viewglobal/2));
 
     // divide heightnumerator by a posts distance to get the posts height for
     // the heightbuffer.  The pixel height is height>>2
     heightnumerator = (TILEGLOBAL*scale)>>6;
 
+    /* the hands fill the view height as they always have; with a custom
+     * FOV they are sized from the 4:3 reference width instead */
+    if (param_fov)
+        weaponheight = (unsigned)(refviewwidth*HEIGHTRATIO) + 1;
+    else
+        weaponheight = viewheight + 1;
+
     /* calculate the angle offset from view angle of each pixel's ray */
     for (i = 0; i < halfview; i++)
     {
         /* start 1/2 pixel over, so viewangle bisects two middle pixels */
-        tang   = (int32_t)i*VIEWGLOBAL/viewwidth/facedist;
+        tang   = i*viewglobal/refviewwidth/facedist;
         angle  = (float)atan(tang);
         intang = (int)(angle * radtoint);
         pixelangle[halfview-1-i] = intang;
@@ -708,9 +918,24 @@ static void SetupWalls (void)
 
 static void SignonScreen (void)
 {
+   byte *pic;
+   word *pixels;
+   int   i;
+
    VL_Startup();
-   VL_MungePic(signon,320,200);
-   VL_MemToScreen(signon,320,200,0,0);
+
+   pic = (byte *) malloc(320*200);
+   CHECKMALLOCRESULT(pic);
+   pixels = (word *) pic;
+   CA_RLEWexpand(signon,pixels,320*200,SIGNONTAG);
+
+   /* each word holds its left pixel in the low byte */
+   for (i = 0; i < 320*200/2; i++)
+      pixels[i] = (word)Retro_SwapLES16(pixels[i]);
+
+   VL_MungePic(pic,320,200);
+   VL_MemToScreen(pic,320,200,0,0);
+   free(pic);
 }
 
 static void FinishSignon (void)
@@ -895,7 +1120,8 @@ static void InitDigiMap (void)
     {
         DigiMap[map[0]] = map[1];
         DigiChannel[map[1]] = map[2];
-        SD_PrepareSound(map[1]);
+        if (!MMBudget)              // otherwise prepared on first use
+            SD_PrepareSound(map[1]);
     }
 }
 
@@ -1071,18 +1297,26 @@ static void InitGame(void)
    boolean didjukebox=false;
 #endif
 
+   ST_LoadBegin ("startup", 0, 0);
+
    /* initialize SDL */
    if(LR_Init(0) < 0)
       exit(1);
    atexit(LR_Quit);
+   LR_SetClock((LR_ClockSource) param_clock, param_clockrate);
 
    SignonScreen ();
 
    VH_Startup ();
+   ST_LoadPhase ("video");
    IN_Startup ();
+   ST_LoadPhase ("input");
    PM_Startup ();
+   ST_LoadPhase ("pages");
    SD_Startup ();
+   ST_LoadPhase ("sound");
    CA_Startup ();
+   ST_LoadPhase ("cache");
    US_Startup ();
 
    /* TODO: Will any memory checking be needed someday?? */
@@ -1093,6 +1327,7 @@ static void InitGame(void)
    ReadConfig ();
 
    SetupSaveGames();
+   ST_LoadPhase ("config");
 
    /* HOLDING DOWN 'M' KEY? */
 #ifndef SPEARDEMO
@@ -1105,12 +1340,14 @@ static void InitGame(void)
 #endif
       /* draw intro screen stuff */
       IntroScreen ();
+   ST_LoadPhase ("intro");
 
    /* load in and lock down some basic chunks */
    CA_CacheGrChunk(STARTFONT);
    CA_CacheGrChunk(STATUSBARPIC);
 
    LoadLatchMem ();
+   ST_LoadPhase ("latches");
    BuildTables ();          /* trig tables */
    SetupWalls ();
 
@@ -1118,10 +1355,13 @@ static void InitGame(void)
 
    /* initialize variables */
    InitRedShifts ();
+   ST_LoadPhase ("tables");
 #ifndef SPEARDEMO
    if(!didjukebox)
 #endif
       FinishSignon();
+   ST_LoadWait ("signon");
+   ST_LoadEnd ();
 }
 
 //===========================================================================
@@ -1136,18 +1376,18 @@ static void InitGame(void)
 
 static boolean SetViewSize (unsigned width, unsigned height)
 {
-   viewwidth   = width         & ~15;   /* must be divisable by 16 */
-   viewheight  = height        & ~1;    /* must be even */
-   centerx     = viewwidth     / 2-1;
-   shootdelta  = viewwidth     / 10;
-   viewscreenx = viewscreeny = screenofs = 0;
+   viewwidth    = width         & ~15;   /* must be divisable by 16 */
+   viewheight   = height        & ~1;    /* must be even */
+   refviewwidth = viewwidth * (scaleFactor * 320) / screenWidth;
+   centerx      = viewwidth     / 2-1;
+   shootdelta   = refviewwidth  / 10;
+   viewscreenx  = (screenWidth - viewwidth) / 2;
+   viewscreeny  = 0;
 
    if((unsigned) viewheight != screenHeight)
-   {
-      viewscreenx = (screenWidth - viewwidth) / 2;
       viewscreeny = (screenHeight - scaleFactor * STATUSLINES - viewheight)/2;
-      screenofs   = viewscreeny * screenWidth + viewscreenx;
-   }
+
+   screenofs    = viewscreeny * screenWidth + viewscreenx;
 
    /* calculate trace angles and projection constants */
    CalcProjection (FOCALLENGTH);
@@ -1248,7 +1488,8 @@ void Quit (const char *errorStr, ...)
         exit(1);
     }
 
-    exit(0);
+    /* a clean exit still fails when loads went over --loadbudget */
+    exit(STLoadsOver ? 2 : 0);
 }
 
 /*
@@ -1267,6 +1508,21 @@ static int DemoLoop(unsigned id)
    switch (id)
    {
       case JE_NONE:
+         if (param_decodebench)
+         {
+            CA_DecodeBench(param_decodebench);
+            SD_ResampleBench(param_decodebench);
+            Quit(NULL);
+         }
+
+         if (param_renderbench)
+         {
+            int differ = RenderBench(param_renderbench);
+            if (differ)
+               Quit("RenderBench: %d frames differ from %s", differ, param_renderbench);
+            Quit(NULL);
+         }
+
          /* check for launch from ted */
          if (param_tedlevel != -1)
          {
@@ -1456,9 +1712,240 @@ static void CheckParameters(int argc, char *argv[])
             {
                 screenWidth = atoi(argv[++i]);
                 screenHeight = atoi(argv[++i]);
-                unsigned factor = screenWidth / 320;
-                if(screenWidth % 320 || screenHeight != 200 * factor && screenHeight != 240 * factor)
-                    printf("Screen size must be a multiple of 320x200 or 320x240!\n"), hasError = true;
+                // the height sets the scale, extra width up to 21:9 is widescreen
+                unsigned factor = screenHeight % 240 ? screenHeight / 200 : screenHeight / 240;
+                if(!factor || screenHeight % 200 && screenHeight % 240 || screenWidth % 16
+                    || screenWidth < 320 * factor || screenWidth * 9 > screenHeight * 21)
+                    printf("Screen size must be a multiple of 320x200 or 320x240, widened in steps of 16 up to 21:9!\n"), hasError = true;
+            }
+        }
+        else if(!strcmp(arg, ("--fov")))
+        {
+            if(++i >= argc)
+            {
+                printf("The fov option is missing the degrees argument!\n");
+                hasError = true;
+            }
+            else
+            {
+                param_fov = atoi(argv[i]);
+                if(param_fov < 50 || param_fov > 110)
+                {
+                    printf("The fov option must be between 50 and 110!\n");
+                    hasError = true;
+                }
+            }
+        }
+        else if(!strcmp(arg, ("--membudget")))
+        {
+            if(++i >= argc)
+            {
+                printf("The membudget option is missing the megabytes argument!\n");
+                hasError = true;
+            }
+            else
+            {
+                int megabytes = atoi(argv[i]);
+                if(megabytes < 4 || megabytes > 4095)
+                {
+                    printf("The membudget option must be between 4 and 4095!\n");
+                    hasError = true;
+                }
+                else MMBudget = (longword) megabytes << 20;
+            }
+        }
+        else if(!strcmp(arg, ("--memreport")))
+            MMReport = true;
+        else if(!strcmp(arg, ("--musiccache")))
+        {
+            if(++i >= argc)
+            {
+                printf("The musiccache option is missing the mode argument!\n");
+                hasError = true;
+            }
+            else if(!strcmp(argv[i], "off")) MusicCacheMode = MCM_OFF;
+            else if(!strcmp(argv[i], "mem")) MusicCacheMode = MCM_MEMORY;
+            else if(!strcmp(argv[i], "disk")) MusicCacheMode = MCM_DISK;
+            else
+            {
+                printf("The musiccache option must be off, mem or disk!\n");
+                hasError = true;
+            }
+        }
+        else if(!strcmp(arg, ("--audiostats")))
+            audiooverlay = true;
+        else if(!strcmp(arg, ("--oplverify")))
+            YM3812Verify = true;
+        else if(!strcmp(arg, ("--renderbench")))
+        {
+            if(++i >= argc)
+            {
+                printf("The renderbench option is missing the hash file argument!\n");
+                hasError = true;
+            }
+            else param_renderbench = argv[i];
+        }
+        else if(!strcmp(arg, ("--decodebench")))
+        {
+            if(++i >= argc)
+            {
+                printf("The decodebench option is missing the runs argument!\n");
+                hasError = true;
+            }
+            else
+            {
+                param_decodebench = atoi(argv[i]);
+                if(param_decodebench < 1)
+                {
+                    printf("The decodebench option needs at least one run!\n");
+                    hasError = true;
+                }
+            }
+        }
+        else if(!strcmp(arg, ("--stats")))
+        {
+            if(++i >= argc)
+            {
+                printf("The stats option is missing the file argument!\n");
+                hasError = true;
+            }
+            else STPath = argv[i];
+        }
+        else if(!strcmp(arg, ("--statsinterval")))
+        {
+            if(++i >= argc)
+            {
+                printf("The statsinterval option is missing the milliseconds argument!\n");
+                hasError = true;
+            }
+            else
+            {
+                STInterval = atoi(argv[i]);
+                if(STInterval < 100)
+                {
+                    printf("The statsinterval option must be at least 100!\n");
+                    hasError = true;
+                }
+            }
+        }
+        else if(!strcmp(arg, ("--loadprofile")))
+        {
+            if(++i >= argc)
+            {
+                printf("The loadprofile option is missing the file argument!\n");
+                hasError = true;
+            }
+            else STLoadPath = argv[i];
+        }
+        else if(!strcmp(arg, ("--loadbudget")))
+        {
+            if(++i >= argc)
+            {
+                printf("The loadbudget option is missing the milliseconds argument!\n");
+                hasError = true;
+            }
+            else
+            {
+                STLoadBudget = atoi(argv[i]);
+                if(STLoadBudget < 1)
+                {
+                    printf("The loadbudget option must be at least 1!\n");
+                    hasError = true;
+                }
+            }
+        }
+        else if(!strcmp(arg, ("--clock")))
+        {
+            if(++i >= argc)
+            {
+                printf("The clock option is missing the source argument!\n");
+                hasError = true;
+            }
+            else if(!strcmp(argv[i], "real")) param_clock = LR_CLOCK_REAL;
+            else if(!strcmp(argv[i], "virtual")) param_clock = LR_CLOCK_VIRTUAL;
+            else
+            {
+                printf("The clock option must be real or virtual!\n");
+                hasError = true;
+            }
+        }
+        else if(!strcmp(arg, ("--clockrate")))
+        {
+            if(++i >= argc)
+            {
+                printf("The clockrate option is missing the percent argument!\n");
+                hasError = true;
+            }
+            else
+            {
+                param_clockrate = atoi(argv[i]);
+                if(param_clockrate < 10 || param_clockrate > 1000)
+                {
+                    printf("The clockrate option must be between 10 and 1000!\n");
+                    hasError = true;
+                }
+            }
+        }
+        else if(!strcmp(arg, ("--frameskip")))
+        {
+            if(++i >= argc)
+            {
+                printf("The frameskip option is missing the policy argument!\n");
+                hasError = true;
+            }
+            else if(!strcmp(argv[i], "off")) framepolicy = FS_RENDERALL;
+            else if(!strcmp(argv[i], "skip")) framepolicy = FS_SKIP;
+            else if(!strcmp(argv[i], "lowres")) framepolicy = FS_LOWRES;
+            else if(!strcmp(argv[i], "adaptive")) framepolicy = FS_ADAPTIVE;
+            else
+            {
+                printf("Unknown frameskip policy \"%s\"!\n", argv[i]);
+                hasError = true;
+            }
+        }
+        else if(!strcmp(arg, ("--framebudget")))
+        {
+            if(++i >= argc)
+            {
+                printf("The framebudget option is missing the milliseconds argument!\n");
+                hasError = true;
+            }
+            else
+            {
+                framebudget = atoi(argv[i]);
+                if(framebudget < 5 || framebudget > 200)
+                {
+                    printf("The framebudget option must be between 5 and 200!\n");
+                    hasError = true;
+                }
+            }
+        }
+        else if(!strcmp(arg, ("--dsp")))
+        {
+            if(++i >= argc)
+            {
+                printf("The dsp option is missing the stages argument!\n");
+                hasError = true;
+            }
+            else
+            {
+                const char *stage = argv[i];
+                DSPStages = 0;
+                while(*stage)
+                {
+                    size_t len = strcspn(stage, ",");
+                    if(len == 2 && !strncmp(stage, "dc", len)) DSPStages |= DSP_DCBLOCK;
+                    else if(len == 7 && !strncmp(stage, "lowpass", len)) DSPStages |= DSP_LOWPASS;
+                    else if(len == 6 && !strncmp(stage, "reverb", len)) DSPStages |= DSP_REVERB;
+                    else if(len == 7 && !strncmp(stage, "limiter", len)) DSPStages |= DSP_LIMITER;
+                    else if(len != 3 || strncmp(stage, "off", len))
+                    {
+                        printf("Unknown dsp stage \"%.*s\"!\n", (int) len, stage);
+                        hasError = true;
+                    }
+                    stage += len;
+                    if(*stage == ',') stage++;
+                }
             }
         }
         else if(!strcmp(arg, ("--joystick")))
@@ -1544,7 +2031,48 @@ static void CheckParameters(int argc, char *argv[])
             " --nowait               Skips intro screens\n"
             " --windowed[-mouse]     Starts the game in a window [and grabs mouse]\n"
             " --res <width> <height> Sets the screen resolution\n"
-            "                        (must be multiple of 320x200 or 320x240)\n"
+            "                        (must be multiple of 320x200 or 320x240,\n"
+            "                        wider sizes up to 21:9 render widescreen)\n"
+            " --fov <degrees>        Horizontal field of view of the 4:3 area\n"
+            "                        (50-110, default: original projection)\n"
+            " --membudget <mb>       Keeps graphics and sounds within the budget,\n"
+            "                        loading pages and sounds on demand\n"
+            " --memreport            Prints memory use and working set per level\n"
+            " --musiccache <mode>    Renders songs to PCM once and streams them:\n"
+            "                        off (default), mem or disk (kept in configdir)\n"
+            " --dsp <stages>         Post processing of the final mix, a comma\n"
+            "                        separated list of dc, lowpass, reverb and\n"
+            "                        limiter (default: off)\n"
+            " --audiostats           Shows mixer load and underruns in game and\n"
+            "                        prints the callback timing on exit\n"
+            " --oplverify            Checks every OPL update against a full,\n"
+            "                        unoptimized render of the same chip state\n"
+            "                        and every music seek against a straight replay\n"
+            " --renderbench <file>   Draws every map from fixed poses, times each\n"
+            "                        frame and checks its hash against the file\n"
+            "                        (the file is written if it doesn't exist;\n"
+            "                        renderbench-wl6.txt is the reference)\n"
+            " --decodebench <runs>   Times the asset decoders over all game data\n"
+            "                        and prints MB/s, ns per item and checksums\n"
+            " --stats <file>         Appends a line of JSON with fps, frame times,\n"
+            "                        audio, cache and memory counters to the file\n"
+            "                        (or FIFO) at every interval\n"
+            " --statsinterval <ms>   Time between stats lines (default: 1000)\n"
+            " --loadprofile <file>   Times startup and each level load by phase and\n"
+            "                        appends a line of JSON per load to the file\n"
+            " --loadbudget <ms>      Flags loads that take longer, not counting\n"
+            "                        fades and the Get Psyched pause, and exits\n"
+            "                        with status 2 if any did\n"
+            " --clock <source>       Game time source: real, or virtual (only moves\n"
+            "                        by what the game waits for, runs flat out and\n"
+            "                        the same way every time) (default: real)\n"
+            " --clockrate <percent>  Speed of the real clock, 200 is fast-forward\n"
+            "                        (default: 100)\n"
+            " --frameskip <policy>   What to give up when a frame runs over budget:\n"
+            "                        off, skip (3D refreshes), lowres (half the\n"
+            "                        wall columns) or adaptive (lowres, then skip)\n"
+            "                        (default: off)\n"
+            " --framebudget <ms>     Time a sim step and refresh may take (default: 28)\n"
             " --joystick <index>     Use the index-th joystick if available\n"
             "                        (-1 to disable joystick, default: 0)\n"
             " --joystickhat <index>  Enables movement with the given coolie hat\n"
@@ -104,7 +104,7 @@ CP_itemtype SndMenu[] = {
     {1, "", 0},
 #else
     {1, STR_NONE, 0},
-    {0, STR_PC, 0},
+    {1, STR_PC, 0},
     {1, STR_ALSB, 0},
     {0, "", 0},
     {0, "", 0},
@@ -1553,15 +1553,16 @@ CP_SaveGame (int quick)
             else
                 strcpy(savepath, name);
 
-            unlink (savepath);
-            file = fopen (savepath, "wb");
-
-            strcpy (input, &SaveGameNames[which][0]);
+            file = OpenSaveFile (savepath);
+            if (file)
+            {
+                strcpy (input, &SaveGameNames[which][0]);
 
-            fwrite (input, 1, 32, file);
-            fseek (file, 32, SEEK_SET);
-            SaveTheGame (file, 0, 0);
-            fclose (file);
+                fwrite (input, 1, 32, file);
+                fseek (file, 32, SEEK_SET);
+                SaveTheGame (file, 0, 0);
+                CloseSaveFile (file);
+            }
 
             return 1;
         }
@@ -1625,15 +1626,17 @@ CP_SaveGame (int quick)
                 else
                     strcpy(savepath, name);
 
-                unlink (savepath);
-                file = fopen (savepath, "wb");
-                fwrite (input, 32, 1, file);
-                fseek (file, 32, SEEK_SET);
+                file = OpenSaveFile (savepath);
+                if (file)
+                {
+                    fwrite (input, 32, 1, file);
+                    fseek (file, 32, SEEK_SET);
 
-                DrawLSAction (1);
-                SaveTheGame (file, LSA_X + 8, LSA_Y + 5);
+                    DrawLSAction (1);
+                    SaveTheGame (file, LSA_X + 8, LSA_Y + 5);
 
-                fclose (file);
+                    CloseSaveFile (file);
+                }
 
                 ShootSnd ();
                 exit = 1;
@@ -1793,7 +1796,7 @@ MouseSensitivity (int unused)
     DrawMouseSens ();
     do
     {
-        rarch_sleep(5);
+        LR_Delay(5);
         ReadAnyControl (&ci);
         switch (ci.dir)
         {
@@ -2060,7 +2063,7 @@ EnterCtrlData (int index, CustomCtrls * cust, void (*DrawRtn) (int), void (*Prin
             redraw = 0;
         }
 
-        rarch_sleep(5);
+        LR_Delay(5);
         ReadAnyControl (&ci);
 
         if (type == MOUSE || type == JOYSTICK)
@@ -2106,7 +2109,7 @@ EnterCtrlData (int index, CustomCtrls * cust, void (*DrawRtn) (int), void (*Prin
                     lastFlashTime = GetTimeCount();
                     VW_UpdateScreen ();
                 }
-                else rarch_sleep(5);
+                else LR_Delay(5);
 
                 //
                 // WHICH TYPE OF INPUT DO WE PROCESS?
@@ -2205,7 +2208,7 @@ EnterCtrlData (int index, CustomCtrls * cust, void (*DrawRtn) (int), void (*Prin
                 while (!cust->allowed[which]);
                 redraw = 1;
                 SD_PlaySound (MOVEGUN1SND);
-                while (ReadAnyControl (&ci), ci.dir != dir_None) rarch_sleep(5);
+                while (ReadAnyControl (&ci), ci.dir != dir_None) LR_Delay(5);
                 IN_ClearKeysDown ();
                 break;
 
@@ -2219,7 +2222,7 @@ EnterCtrlData (int index, CustomCtrls * cust, void (*DrawRtn) (int), void (*Prin
                 while (!cust->allowed[which]);
                 redraw = 1;
                 SD_PlaySound (MOVEGUN1SND);
-                while (ReadAnyControl (&ci), ci.dir != dir_None) rarch_sleep(5);
+                while (ReadAnyControl (&ci), ci.dir != dir_None) LR_Delay(5);
                 IN_ClearKeysDown ();
                 break;
             case dir_North:
@@ -2638,7 +2641,7 @@ int CP_ChangeView (int unused)
     do
     {
         CheckPause ();
-        rarch_sleep(5);
+        LR_Delay(5);
         ReadAnyControl (&ci);
         switch (ci.dir)
         {
@@ -3033,7 +3036,7 @@ HandleMenu (CP_iteminfo * item_i, CP_itemtype * items, void (*routine) (int w))
                 routine (which);
             VW_UpdateScreen ();
         }
-        else rarch_sleep(5);
+        else LR_Delay(5);
 
         CheckPause ();
 
@@ -3205,7 +3208,7 @@ void DrawHalfStep (int x, int y)
     VWB_DrawPic (x, y, C_CURSOR1PIC);
     VW_UpdateScreen ();
     SD_PlaySound (MOVEGUN1SND);
-    rarch_sleep (8 * 100 / 7);
+    LR_Delay(8 * 100 / 7);
 }
 
 
@@ -3241,7 +3244,7 @@ void TicDelay (int count)
 
     do
     {
-        rarch_sleep(5);
+        LR_Delay(5);
         ReadAnyControl (&ci);
         if (ci.dir == dir_None)
            break;
@@ -3375,7 +3378,7 @@ Confirm (const char *string)
             tick ^= 1;
             lastBlinkTime = GetTimeCount();
         }
-        else rarch_sleep(5);
+        else LR_Delay(5);
 
 #ifdef SPANISH
     }
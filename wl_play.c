@@ -37,6 +37,7 @@ int godmode, singlestep, extravbls = 0;
 
 byte tilemap[MAPSIZE][MAPSIZE]; /* wall values only */
 byte spotvis[MAPSIZE][MAPSIZE];
+byte tiledist[MAPSIZE][MAPSIZE];
 objtype *actorat[MAPSIZE][MAPSIZE];
 
 /* replacing refresh manager */
@@ -1147,6 +1148,100 @@ think:
 
 int32_t funnyticount;
 
+/*
+=============================================================================
+
+                            FRAME SCHEDULER
+
+When a sim step and a refresh together take longer than framebudget, the
+tics pile up and the game lurches. The scheduler keeps smoothed costs of
+both and, per framepolicy, halves the wall resolution or leaves the 3D
+refresh out of some frames, so the sim keeps running in small steps.
+
+=============================================================================
+*/
+
+#define MAXSKIPPED      3           // refreshes dropped in a row at most
+
+framepolicy_t framepolicy = FS_RENDERALL;
+int           framebudget = 28;     // ms, about 35 refreshes a second
+framestats_t  framestats;
+
+static int    skippedinrow;
+
+static void SmoothCost (longword *cost, longword usec)
+{
+   *cost = *cost ? (*cost * 7 + usec) / 8 : usec;
+}
+
+/*
+===================
+=
+= FrameWanted
+=
+= Decides whether this frame gets a 3D refresh, and at which resolution
+=
+===================
+*/
+
+static boolean FrameWanted (void)
+{
+   longword budget = framebudget * 1000;
+   longword sim    = framestats.simusec;
+   longword render = framestats.renderusec;
+   int      skips;
+
+   framestats.frames++;
+
+   if (framepolicy == FS_RENDERALL || screenfaded || fizzlein)
+      return true;
+
+   if (framepolicy == FS_LOWRES || framepolicy == FS_ADAPTIVE)
+   {
+      if (raystep == 1 && sim + render > budget)
+      {
+         raystep = 2;
+         framestats.switches++;
+      }
+      else if (raystep == 2 && sim + render * 2 < budget * 3 / 4)
+         raystep = 1;       // full resolution would fit with room to spare
+   }
+
+   if (framepolicy == FS_SKIP || (framepolicy == FS_ADAPTIVE && raystep == 2))
+   {
+      //
+      // skip enough refreshes that a refresh and the steps it
+      // covers average out within the budget
+      //
+      if (sim >= budget)
+         skips = MAXSKIPPED;
+      else
+         skips = (render + budget - sim - 1) / (budget - sim) - 1;
+      if (skips > MAXSKIPPED)
+         skips = MAXSKIPPED;
+
+      if (skippedinrow < skips)
+      {
+         skippedinrow++;
+         framestats.skipped++;
+         return false;
+      }
+   }
+
+   skippedinrow = 0;
+   if (raystep > 1)
+      framestats.lowres++;
+   return true;
+}
+
+void ReportFrameStats (void)
+{
+   printf("Frames: %u steps, %u without refresh, %u at half resolution "
+          "(%u switches), %u us sim, %u us refresh\n",
+          framestats.frames, framestats.skipped, framestats.lowres,
+          framestats.switches, framestats.simusec, framestats.renderusec);
+}
+
 
 void PlayLoop (void)
 {
@@ -1167,9 +1262,13 @@ void PlayLoop (void)
 
    do
    {
+      uint32_t simstart, renderstart;
+
       PollControls ();
+      STGame.tics += tics;
 
       /* actor thinking */
+      simstart = LR_GetMicroTicks();
       madenoise = false;
 
       MoveDoors ();
@@ -1180,7 +1279,14 @@ void PlayLoop (void)
 
       UpdatePaletteShifts ();
 
-      ThreeDRefresh ();
+      renderstart = LR_GetMicroTicks();
+      SmoothCost (&framestats.simusec, renderstart - simstart);
+
+      if (FrameWanted ())
+      {
+         ThreeDRefresh ();
+         SmoothCost (&framestats.renderusec, LR_GetMicroTicks() - renderstart);
+      }
 
       /* MAKE FUNNY FACE IF BJ DOESN'T MOVE FOR AWHILE */
 #ifdef SPEAR
@@ -1197,6 +1303,7 @@ void PlayLoop (void)
       gamestate.TimeCount += tics;
 
       UpdateSoundLoc ();      // JAB
+      ST_Update ();
       if (screenfaded)
          VW_FadeIn ();
 
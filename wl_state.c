@@ -1079,6 +1079,7 @@ boolean CheckLine (objtype *ob)
     int32_t     ltemp;
     int         xfrac,yfrac,deltafrac;
     unsigned    value,intercept;
+    int         skip;
 
     x1 = ob->x >> UNSIGNEDSHIFT;            // 1/256 tile precision
     y1 = ob->y >> UNSIGNEDSHIFT;
@@ -1127,7 +1128,20 @@ boolean CheckLine (objtype *ob)
             x += xstep;
 
             if (!value)
+            {
+                //
+                // every tile closer than tiledist is empty, so cross
+                // as many columns as the line can take without leaving it
+                //
+                skip = tiledist[x-xstep][y]-1;
+                if (abs(ystep) > 256)
+                    skip = skip*256/abs(ystep);
+                if (skip > (xt2-x)*xstep)
+                    skip = (xt2-x)*xstep;
+                x += skip*xstep;
+                yfrac += skip*ystep;
                 continue;
+            }
 
             if (value<128 || value>256)
                 return false;
@@ -1181,7 +1195,16 @@ boolean CheckLine (objtype *ob)
             y += ystep;
 
             if (!value)
+            {
+                skip = tiledist[x][y-ystep]-1;
+                if (abs(xstep) > 256)
+                    skip = skip*256/abs(xstep);
+                if (skip > (yt2-y)*ystep)
+                    skip = (yt2-y)*ystep;
+                y += skip*ystep;
+                xfrac += skip*xstep;
                 continue;
+            }
 
             if (value<128 || value>256)
                 return false;
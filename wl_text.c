@@ -637,7 +637,7 @@ static void ShowArticle (char *article)
             firstpage = false;
          }
       }
-      rarch_sleep(5);
+      LR_Delay(5);
 
       LastScan = 0;
       ReadAnyControl(&ci);